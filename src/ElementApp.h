@@ -80,6 +80,8 @@ namespace Tags
     const Identifier session            = "session";
     const Identifier state              = "state";
 	const Identifier programState		= "programState";
+    const Identifier stateChunk         = "stateChunk";
+    const Identifier lookupIndex        = "lookupIndex";
     const Identifier beatsPerBar        = "beatsPerBar";
     const Identifier beatDivisor        = "beatDivisor";
     const Identifier midiChannel        = "midiChannel";
@@ -113,6 +115,8 @@ namespace Tags
     const Identifier keyEnd             = "keyEnd";
 
     const Identifier velocityCurveMode  = "velocityCurveMode";
+    const Identifier midiCoalescing     = "midiCoalescing";
+    const Identifier subBlockSplitting  = "subBlockSplitting";
     const Identifier workspace          = "workspace";
 
     const Identifier externalSync       = "externalSync";
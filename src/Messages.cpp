@@ -71,7 +71,7 @@ public:
     {
         node.getArcs (arcs);
         Node mutableNode (node);
-        mutableNode.savePluginState();
+        mutableNode.savePluginState (true);
         node.getRelativePosition (x, y);
         nodeData = node.getValueTree().createCopy();
         Node::sanitizeRuntimeProperties (nodeData);
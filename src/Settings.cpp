@@ -40,6 +40,9 @@ const char* Settings::workspaceKey              = "workspace";
 const char* Settings::midiEngineKey             = "midiEngine";
 const char* Settings::oscHostPortKey            = "oscHostPortKey";
 const char* Settings::oscHostEnabledKey         = "oscHostEnabledKey";
+const char* Settings::renderThreadsKey          = "renderThreads";
+const char* Settings::midiOutputLookaheadKey    = "midiOutputLookahead";
+const char* Settings::autosaveIntervalKey       = "autosaveInterval";
 
 enum OptionsMenuItemId
 {
@@ -351,6 +354,53 @@ void Settings::setOscHostPort (int port)
         p->setValue (oscHostPortKey, port);
 }
 
+int Settings::getNumRenderThreads() const
+{
+    if (auto* p = getProps())
+        return jmax (0, p->getIntValue (renderThreadsKey, 0));
+    return 0;
+}
+
+void Settings::setNumRenderThreads (int numThreads)
+{
+    numThreads = jmax (0, numThreads);
+    if (getNumRenderThreads() == numThreads)
+        return;
+    if (auto* p = getProps())
+        p->setValue (renderThreadsKey, numThreads);
+}
+
+double Settings::getMidiOutputLookahead() const
+{
+    if (auto* p = getProps())
+        return p->getDoubleValue (midiOutputLookaheadKey, 0.0);
+    return 0.0;
+}
+
+void Settings::setMidiOutputLookahead (double milliseconds)
+{
+    if (getMidiOutputLookahead() == milliseconds)
+        return;
+    if (auto* p = getProps())
+        p->setValue (midiOutputLookaheadKey, milliseconds);
+}
+
+int Settings::getAutosaveInterval() const
+{
+    if (auto* p = getProps())
+        return jmax (0, p->getIntValue (autosaveIntervalKey, 10));
+    return 10;
+}
+
+void Settings::setAutosaveInterval (int seconds)
+{
+    seconds = jmax (0, seconds);
+    if (getAutosaveInterval() == seconds)
+        return;
+    if (auto* p = getProps())
+        p->setValue (autosaveIntervalKey, seconds);
+}
+
 void Settings::addItemsToMenu (Globals& world, PopupMenu& menu)
 {
     auto& devices (world.getDeviceManager());
@@ -49,6 +49,9 @@ public:
     static const char* midiEngineKey;
     static const char* oscHostPortKey;
     static const char* oscHostEnabledKey;
+    static const char* renderThreadsKey;
+    static const char* midiOutputLookaheadKey;
+    static const char* autosaveIntervalKey;
 
     std::unique_ptr<XmlElement> getLastGraph() const;
     void setLastGraph (const ValueTree& data);
@@ -111,6 +114,20 @@ public:
     int getOscHostPort() const;
     void setOscHostPort (int);
 
+    /** Number of extra threads used to render graphs. 0 renders on the
+        audio thread only */
+    int getNumRenderThreads() const;
+    void setNumRenderThreads (int);
+
+    /** Milliseconds added to the send time of MIDI output. Can be negative
+        to compensate for a slow MIDI interface */
+    double getMidiOutputLookahead() const;
+    void setMidiOutputLookahead (double);
+
+    /** Seconds between session autosaves. 0 disables autosave */
+    int getAutosaveInterval() const;
+    void setAutosaveInterval (int);
+
 private:
     PropertiesFile* getProps() const;
 };
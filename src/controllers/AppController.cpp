@@ -220,7 +220,7 @@ void AppController::handleMessage (const Message& msg)
         jassert (parent.hasType (Tags::node));
 
         const Node graph (parent, false);
-        node.savePluginState();
+        node.savePluginState (true);
         Node newNode (node.getValueTree().createCopy(), false);
         
         if (newNode.isValid() && graph.isValid())
@@ -475,7 +475,7 @@ bool AppController::perform (const InvocationInfo& info)
         {
             auto session = getWorld().getSession();
             auto node = session->getCurrentGraph();
-            node.savePluginState();
+            node.savePluginState (true);
             
             if (!lastExportedGraph.isDirectory())
                 lastExportedGraph = lastExportedGraph.getParentDirectory();
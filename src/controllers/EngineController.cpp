@@ -79,6 +79,8 @@ struct RootGraphHolder
             root->setRenderMode (mode);
             root->setMidiChannels (channels);
             root->setMidiProgram (program);
+            root->setMidiCoalescing ((bool) model.getProperty (Tags::midiCoalescing, false));
+            root->setSubBlockSplitting ((bool) model.getProperty (Tags::subBlockSplitting, false));
 
             if (engine->addGraph (root))
             {
@@ -384,7 +386,7 @@ void EngineController::addGraph (const Node& newGraph)
 void EngineController::duplicateGraph (const Node& graph)
 {
     Node duplicate (graph.getValueTree().createCopy());
-    duplicate.savePluginState(); // need objects present to update processor states
+    duplicate.savePluginState (true); // need objects present to update processor states
     Node::sanitizeRuntimeProperties (duplicate.getValueTree());
     // reset UUIDs to avoid compilcations with undoable actions
     duplicate.forEach ([](const ValueTree& tree)
@@ -652,7 +654,7 @@ void EngineController::deactivate()
         gui->closeAllPluginWindows();
     }
     
-    session->saveGraphState();
+    session->saveGraphState (true);
     graphs->clear();
     
     engine->deactivate();
@@ -720,6 +722,8 @@ void EngineController::setRootNode (const Node& newRootNode)
         proc->setMidiChannels (newRootNode.getMidiChannels().get());
         proc->setVelocityCurveMode ((VelocityCurve::Mode)(int) newRootNode.getProperty (
             Tags::velocityCurveMode, (int) VelocityCurve::Linear));
+        proc->setMidiCoalescing ((bool) newRootNode.getProperty (Tags::midiCoalescing, false));
+        proc->setSubBlockSplitting ((bool) newRootNode.getProperty (Tags::subBlockSplitting, false));
     }
     else
     {
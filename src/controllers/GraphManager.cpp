@@ -92,6 +92,44 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (NodeModelUpdater);
 };
 
+/** Decodes and sets the plugin state of a node on a loader thread. The
+    model is read when the job is created and the remaining node properties
+    are applied on the message thread once it finishes */
+class NodeStateRestoreJob : public ThreadPoolJob
+{
+public:
+    NodeStateRestoreJob (const Node& n)
+        : ThreadPoolJob ("restore " + n.getName()), node (n), restorer (n) { }
+
+    JobStatus runJob() override
+    {
+        restorer.restore();
+        return jobHasFinished;
+    }
+
+    /** Call on the message thread after the job has finished */
+    void restoreNodeProperties() { node.restoreNodeProperties(); }
+
+private:
+    Node node;
+    Node::PluginStateRestorer restorer;
+    JUCE_DECLARE_NON_COPYABLE (NodeStateRestoreJob);
+};
+
+/** Returns true if the node's state can be restored off the message thread
+    while other plugins are restored. Only LV2 is restored this way, other
+    formats and the internal nodes may touch the GUI or devices. LV2 instances
+    share the host's world and URID map, so these jobs never run concurrently
+    with each other */
+static bool canRestoreInBackground (const Node& node)
+{
+    GraphNodePtr obj = node.getGraphNode();
+    if (obj == nullptr || obj->getAudioPluginInstance() == nullptr)
+        return false;
+    PluginDescription desc; obj->getPluginDescription (desc);
+    return desc.pluginFormatName == "LV2";
+}
+
 /** This enforces correct IO nodes based on the graph processor's settings
     in virtual methods like 'acceptsMidi' and 'getTotalNumInputChannels'
     It uses the controller for all node operations so the model will
@@ -263,7 +301,7 @@ GraphNode* GraphManager::createPlaceholder (const Node& node)
 {
     PluginDescription desc; node.getPluginDescription (desc);
     auto* ph = new PlaceholderProcessor ();
-    ph->setupFor (node, processor.getSampleRate(), processor.getBlockSize());
+    ph->setupFor (node, processor.getSampleRate(), processor.getRenderBlockSize());
     return processor.addNode (ph, node.getNodeId());
 }
 
@@ -367,7 +405,7 @@ uint32 GraphManager::addFilter (const PluginDescription* desc, double rx, double
             {
                 proc->suspendProcessing (true);
                 proc->releaseResources();
-                proc->prepareToPlay (processor.getSampleRate(), processor.getBlockSize());
+                proc->prepareToPlay (processor.getSampleRate(), processor.getRenderBlockSize());
                 proc->suspendProcessing (false);
             }
         }
@@ -508,17 +546,21 @@ void GraphManager::setNodeModel (const Node& node)
     graph   = node.getValueTree();
     arcs    = node.getArcsValueTree();
     nodes   = node.getNodesValueTree();
+    Node (graph, false).attachLookupIndex();
     
-    Array<ValueTree> failed;
+    // plugins are instantiated first and their states restored after, so
+    // the slow part can run concurrently
+    Array<ValueTree> failed, created;
     for (int i = 0; i < nodes.getNumChildren(); ++i)
     {
         Node node (nodes.getChild (i), false);
         const PluginDescription desc (pluginManager.findDescriptionFor (node));
         if (GraphNodePtr obj = createFilter (&desc, 0.0, 0.0, node.getNodeId()))
         {
-            setupNode (node.getValueTree(), obj);
+            setupNode (node.getValueTree(), obj, false);
             obj->setEnabled (node.isEnabled());
             node.setProperty (Tags::enabled, obj->isEnabled());
+            created.add (node.getValueTree());
         }
         else if (GraphNodePtr ph = createPlaceholder (node))
         {
@@ -542,6 +584,9 @@ void GraphManager::setNodeModel (const Node& node)
 
     // If you hit this, then failed nodes didn't get handled properly
     jassert (nodes.getNumChildren() == processor.getNumNodes());
+
+    restoreNodeStates (created);
+    created.clearQuick();
     
     for (int i = 0; i < arcs.getNumChildren(); ++i)
     {
@@ -592,7 +637,7 @@ void GraphManager::savePluginStates()
     for (int i = 0; i < nodes.getNumChildren(); ++i)
     {
         Node node (nodes.getChild (i), false);
-        node.savePluginState();
+        node.savePluginState (true);
     }
 }
 
@@ -609,6 +654,7 @@ void GraphManager::clear()
         arcs.removeAllChildren (nullptr);
         graph.addChild (nodes, -1, nullptr);
         graph.addChild (arcs, -1, nullptr);
+        Node (graph, false).attachLookupIndex();
     }
     
     processor.clear();
@@ -647,7 +693,40 @@ void GraphManager::processorArcsChanged()
     changed();
 }
 
-void GraphManager::setupNode (const ValueTree& data, GraphNodePtr obj)
+void GraphManager::restoreNodeStates (const Array<ValueTree>& nodesToRestore)
+{
+    // declared before the pool so it is destroyed after the threads have stopped
+    OwnedArray<NodeStateRestoreJob> jobs;
+    std::unique_ptr<ThreadPool> pool;
+
+    for (const auto& data : nodesToRestore)
+    {
+        const Node node (data, false);
+        if (! canRestoreInBackground (node))
+            continue;
+
+        if (pool == nullptr)
+            pool.reset (new ThreadPool (1)); // one loader, jobs run in order
+        pool->addJob (jobs.add (new NodeStateRestoreJob (node)), false);
+    }
+
+    // the rest need the message thread, restore them while the pool works
+    for (const auto& data : nodesToRestore)
+    {
+        Node node (data, false);
+        if (canRestoreInBackground (node))
+            continue;
+        node.restorePluginState();
+    }
+
+    for (auto* job : jobs)
+    {
+        pool->waitForJobToFinish (job, -1);
+        job->restoreNodeProperties();
+    }
+}
+
+void GraphManager::setupNode (const ValueTree& data, GraphNodePtr obj, bool restoreState)
 {
     jassert (obj && data.hasType (Tags::node));
     Node node (data, false);
@@ -673,7 +752,7 @@ void GraphManager::setupNode (const ValueTree& data, GraphNodePtr obj)
                 proc->suspendProcessing (true);
                 proc->releaseResources();
                 proc->setBusesLayoutWithoutEnabling (layout);
-                proc->prepareToPlay (processor.getSampleRate(), processor.getBlockSize());
+                proc->prepareToPlay (processor.getSampleRate(), processor.getRenderBlockSize());
                 proc->suspendProcessing (false);
             }
             
@@ -691,7 +770,8 @@ void GraphManager::setupNode (const ValueTree& data, GraphNodePtr obj)
         node.resetPorts();
     
     jassert (node.getNumPorts() == static_cast<int> (obj->getNumPorts()));
-    node.restorePluginState();
+    if (restoreState)
+        node.restorePluginState();
 }
 
 // MARK: Root Graph Controller
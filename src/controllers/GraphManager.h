@@ -112,7 +112,8 @@ private:
     GraphNode* createFilter (const PluginDescription* desc, double x = 0.0f, double y = 0.0f,
                              uint32 nodeId = 0);
     GraphNode* createPlaceholder (const Node& node);
-    void setupNode (const ValueTree& data, GraphNodePtr object);
+    void setupNode (const ValueTree& data, GraphNodePtr object, bool restoreState = true);
+    void restoreNodeStates (const Array<ValueTree>& nodesToRestore);
     
     void processorArcsChanged();
 
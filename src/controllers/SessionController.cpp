@@ -39,6 +39,10 @@ void SessionController::activate()
     currentSession = app->getWorld().getSession();
     document = new SessionDocument (currentSession);
     document->setLastDocumentOpened (DataPath::defaultSessionDir().getChildFile ("Untitled.els"));
+   #if ! EL_RUNNING_AS_PLUGIN
+    autosave.start (currentSession, DataPath::applicationDataDir().getChildFile ("Autosave.els"),
+                    app->getWorld().getSettings().getAutosaveInterval());
+   #endif
 }
 
 void SessionController::deactivate()
@@ -46,6 +50,7 @@ void SessionController::deactivate()
     auto& world = getWorld();
     auto& settings (world.getSettings());
     auto* props = settings.getUserSettings();
+    autosave.stop();
     
     if (document)
     {
@@ -219,9 +224,7 @@ void SessionController::loadNewSessionData()
 
     if (file.existsAsFile())
     {
-        ValueTree data;
-        if (auto xml = XmlDocument::parse (file))
-            data = ValueTree::fromXml (*xml);
+        const auto data = Session::readFromFile (file);
         if (data.isValid() && data.hasType (Tags::session))
             wasLoaded = currentSession->loadData (data);
     }
@@ -22,6 +22,7 @@
 #include "controllers/AppController.h"
 #include "documents/SessionDocument.h"
 #include "session/Session.h"
+#include "session/SessionAutosave.h"
 #include "Signals.h"
 
 namespace Element {
@@ -51,6 +52,7 @@ public:
 private:
     SessionPtr currentSession;
     ScopedPointer<SessionDocument> document;
+    SessionAutosave autosave;
     void loadNewSessionData();
     void refreshOtherControllers();
 };
@@ -76,7 +76,7 @@ Result GraphDocument::saveDocument (const File& file)
         return Result::fail ("No graph is loaded");
     }
 
-    session->saveGraphState();
+    session->saveGraphState (true);
     
     if (session->writeToFile (file))
         return Result::ok();
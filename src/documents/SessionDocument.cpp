@@ -18,6 +18,7 @@
 */
 
 #include "session/Session.h"
+#include "session/SessionFile.h"
 #include "documents/SessionDocument.h"
 
 namespace Element {
@@ -61,7 +62,13 @@ namespace Element {
             return Result::fail ("No session data target");
 
         String error;
-        if (auto e = XmlDocument::parse (file))
+        if (SessionFile::isSessionFile (file))
+        {
+            // autosaves and binary sessions
+            if (! session->loadData (Session::readFromFile (file)))
+                error = "Could not load session data";
+        }
+        else if (auto e = XmlDocument::parse (file))
         {
             ValueTree newData (ValueTree::fromXml (*e));
             if (! newData.isValid() && newData.hasType ("session"))
@@ -87,15 +94,12 @@ namespace Element {
         if (! session)
             return Result::fail ("Nil session");
         
-        session->saveGraphState();
-        if (auto e = session->createXml())
-        {
-            Result res (e->writeToFile (file, String())
-                    ? Result::ok() : Result::fail ("Error writing session file"));
-            return res;
-        }
-
-        return Result::fail ("Could not create session data");
+        // saved in the chunked format. Every plugin is serialized since some
+        // don't report changes made in their editors, autosaves only save the
+        // dirty ones. XML stays available for exporting through Session::createXml
+        session->saveGraphState (true);
+        return session->writeToFile (file) ? Result::ok()
+            : Result::fail ("Error writing session file");
     }
 
     File SessionDocument::getLastDocumentOpened() { return lastSession; }
@@ -23,7 +23,9 @@
 #include "engine/MidiClock.h"
 #include "engine/MidiChannelMap.h"
 #include "engine/MidiEngine.h"
+#include "engine/MidiOutputScheduler.h"
 #include "engine/MidiTranspose.h"
+#include "engine/RenderThreadPool.h"
 #include "engine/Transport.h"
 #include "Globals.h"
 #include "Settings.h"
@@ -95,13 +97,16 @@ void RootGraph::updateChannelNames (AudioIODevice* device)
             audioOutputNames.add(namesOut[i]);
 }
 
-struct RootGraphRender : public AsyncUpdater
+struct RootGraphRender : public AsyncUpdater,
+                         public RenderSchedule::Performer
 {
     std::function<void()> onActiveGraphChanged;
 
     RootGraphRender()
     {
         graphs.ensureStorageAllocated (32);
+        slots.ensureStorageAllocated (32);
+        updateSchedule();
     }
 
     void handleAsyncUpdate() override
@@ -131,18 +136,22 @@ struct RootGraphRender : public AsyncUpdater
     {
         numInputChans   = numIns;
         numOutputChans  = numOuts;
-        audioTemp.setSize (jmax (numIns, numOuts), numSamples);
-        audioOut.setSize (audioTemp.getNumChannels(), audioTemp.getNumSamples());
+        audioOut.setSize (jmax (numIns, numOuts), numSamples);
+        for (auto* slot : slots)
+            slot->prepare (audioOut.getNumChannels(), audioOut.getNumSamples());
     }
 
     void releaseBuffers()
     {
         numInputChans = numOutputChans = 0;
         midiOut.clear();
-        midiTemp.clear();
-        audioTemp.setSize (1, 1);
         audioOut.setSize (1, 1);
+        for (auto* slot : slots)
+            slot->release();
     }
+
+    /** Graphs are rendered concurrently on this pool when there is more than one */
+    void setRenderThreadPool (RenderThreadPool* newPool) { pool = newPool; }
     void dumpGraphs() {
         
     }
@@ -190,21 +199,66 @@ struct RootGraphRender : public AsyncUpdater
         {
 			audioOut.setSize (buffer.getNumChannels(), buffer.getNumSamples(),
 							  false, false, true);
-			audioTemp.setSize (buffer.getNumChannels(), buffer.getNumSamples(),
-							  false, false, true);
 
             // clear the mixing area
             for (int i = numChans; --i >= 0;)
                 audioOut.clear (i, 0, numSamples);
             midiOut.clear();
             
-            for (auto* const graph : graphs)
+            for (int g = 0; g < graphs.size(); ++g)
             {
-                // copy inputs, clear outs if more than input count
-                for (int i = 0; i < numInputChans; ++i)
-                    audioTemp.copyFrom (i, 0, buffer, i, 0, numSamples);
-                for (int i = numInputChans; i < numChans; ++i)
-                    audioTemp.clear (i, 0, numSamples);
+                auto* const graph = graphs.getUnchecked (g);
+                auto* const slot  = slots.getUnchecked (g);
+                auto& audioTemp   = slot->audio;
+                auto& midiTemp    = slot->midi;
+
+                if (graphChanged && ((current->isSingle() && current != graph) ||
+                                     (modeChanged && !current->isSingle() && graph->isSingle())))
+                {
+                    // a dormant graph is already silent, no need to wake it to fade out
+                    slot->mix = slot->dormant ? GraphSlot::Silent : GraphSlot::FadeOut;
+                }
+                else if ((graph == current && graph->isSingle()) ||
+                         (!graph->isSingle() && (current != nullptr) && !current->isSingle()))
+                {
+                    // if it's the current single graph or both are parallel...
+                    if (graphChanged && (graph->isSingle() || 
+                                        (modeChanged && !graph->isSingle() && !current->isSingle())))
+                        slot->mix = GraphSlot::FadeIn;
+                    else
+                        slot->mix = GraphSlot::Mix;
+                }
+                else
+                {
+                    slot->mix = GraphSlot::Silent;
+                }
+
+                if (slot->mix != GraphSlot::Silent)
+                {
+                    if (slot->dormant)
+                        warmUp (g, numChans, numSamples);
+                    slot->silentSamples = slot->inaudibleSamples = 0;
+                }
+                else if (slot->dormant)
+                {
+                    continue;
+                }
+
+                audioTemp.setSize (numChans, numSamples, false, false, true);
+
+                if (slot->mix != GraphSlot::Silent)
+                {
+                    // copy inputs, clear outs if more than input count
+                    for (int i = 0; i < numInputChans; ++i)
+                        audioTemp.copyFrom (i, 0, buffer, i, 0, numSamples);
+                    for (int i = numInputChans; i < numChans; ++i)
+                        audioTemp.clear (i, 0, numSamples);
+                }
+                else
+                {
+                    // inaudible graphs get silence so their tails can decay
+                    audioTemp.clear (0, numSamples);
+                }
                 
                 // clear so messages: avoids feedback loop when IO node ins are 
                 // connected to IO node outs
@@ -233,47 +287,50 @@ struct RootGraphRender : public AsyncUpdater
                     // current single graph or parallel graphs get MIDI always
                     midiTemp.addEvents (midi, 0, numSamples, 0);
                 }
+            }
+
+            // each graph renders into its own slot, so they can go in parallel
+            if (pool != nullptr && graphs.size() > 1 && ! pool->isPerforming())
+                pool->perform (*schedule, *this);
+            else
+                schedule->performSerial (*this);
 
+            // sum in graph order after the join so the mix is deterministic
+            for (int g = 0; g < graphs.size(); ++g)
+            {
+                auto* const slot = slots.getUnchecked (g);
+                const auto& audioTemp = slot->audio;
+
+                switch (slot->mix)
                 {
-                    const ScopedLock sl (graph->getCallbackLock());
-                    if (graph->isSuspended())
+                    case GraphSlot::FadeOut:
                     {
-                        graph->processBlockBypassed (audioTemp, midiTemp);
-                    }
-                    else
-                    {
-                        graph->processBlock (audioTemp, midiTemp);
-                    }
-                }
-                
-                if (graphChanged && ((current->isSingle() && current != graph) ||
-                                     (modeChanged && !current->isSingle() && graph->isSingle())))
-                                     
-                {
-                    // DBG("  FADE OUT LAST GRAPH: " << graph->engineIndex);
-                    for (int i = 0; i < numOutputChans; ++i)
+                        // DBG("  FADE OUT LAST GRAPH: " << graph->engineIndex);
+                        for (int i = 0; i < numOutputChans; ++i)
                             audioOut.addFromWithRamp (i, 0, audioTemp.getReadPointer (i), 
                                                       numSamples, 1.f, 0.f);
-                }
-                else if ((graph == current && graph->isSingle()) ||
-                         (!graph->isSingle() && (current != nullptr) && !current->isSingle()))
-                {
-                    // if it's the current single graph or both are parallel...
-                    if (graphChanged && (graph->isSingle() || 
-                                        (modeChanged && !graph->isSingle() && !current->isSingle())))
+                    } break;
+
+                    case GraphSlot::FadeIn:
                     {
                         // DBG("  FADE IN NEW GRAPH: " << graph->engineIndex);
                         for (int i = 0; i < numOutputChans; ++i)
                             audioOut.addFromWithRamp (i, 0, audioTemp.getReadPointer (i), 
                                                       numSamples, 0.f, 1.f);
-                    }
-                    else
+                        midiOut.addEvents (slot->midi, 0, numSamples, 0);
+                    } break;
+
+                    case GraphSlot::Mix:
                     {
                         for (int i = 0; i < numOutputChans; ++i)
                             audioOut.addFrom (i, 0, audioTemp, i, 0, numSamples);
-                    }
-                    
-                    midiOut.addEvents (midiTemp, 0, numSamples, 0);
+                        midiOut.addEvents (slot->midi, 0, numSamples, 0);
+                    } break;
+
+                    case GraphSlot::Silent:
+                    default:
+                        updateDormancy (g, numSamples);
+                        break;
                 }
             }
 
@@ -292,6 +349,17 @@ struct RootGraphRender : public AsyncUpdater
                 program.program = msg.getProgramChangeNumber();
                 program.channel = msg.getChannel();
             }
+
+            // pre-roll the next graph now so it's warm when it becomes current
+            if (program.wasRequested() && ! locked)
+            {
+                const int nextGraph = findGraphForProgram (program);
+                if (nextGraph != currentGraph && isPositiveAndBelow (nextGraph, slots.size())
+                    && slots.getUnchecked(nextGraph)->dormant)
+                {
+                    warmUp (nextGraph, numChans, numSamples);
+                }
+            }
            #endif // EL_PRO
 
             // done with input, swap it with the rendered output
@@ -307,6 +375,23 @@ struct RootGraphRender : public AsyncUpdater
         lastGraph = currentGraph;
     }
     
+    void performStage (int index) override
+    {
+        auto* const graph = graphs.getUnchecked (index);
+        auto* const slot  = slots.getUnchecked (index);
+        if (slot->dormant)
+            return;
+        const ScopedLock sl (graph->getCallbackLock());
+        if (graph->isSuspended())
+        {
+            graph->processBlockBypassed (slot->audio, slot->midi);
+        }
+        else
+        {
+            graph->processBlock (slot->audio, slot->midi);
+        }
+    }
+
     /** not realtime safe! */
 
     bool addGraph (RootGraph* graph)
@@ -314,6 +399,8 @@ struct RootGraphRender : public AsyncUpdater
         graph->setLocked (locked);
         graphs.add (graph);
         graph->engineIndex = graphs.size() - 1;
+        slots.add (new GraphSlot())->prepare (audioOut.getNumChannels(), audioOut.getNumSamples());
+        updateSchedule();
 
         if (graph->engineIndex == 0)
         {
@@ -328,8 +415,10 @@ struct RootGraphRender : public AsyncUpdater
     void removeGraph (RootGraph* graph)
     {
         jassert (graphs.contains (graph));
+        slots.remove (graphs.indexOf (graph));
         graphs.removeFirstMatchingValue (graph);
         graph->engineIndex = -1;
+        updateSchedule();
         updateIndexes();
         if (currentGraph >= graphs.size())
             currentGraph = graphs.size() - 1;
@@ -372,9 +461,95 @@ private:
 
     int numInputChans       = -1;
     int numOutputChans      = -1;
-    AudioSampleBuffer   audioOut, audioTemp;
+    AudioSampleBuffer   audioOut;
+    MidiBuffer midiOut;
+
+    /** Scratch buffers and mixing state for one graph */
+    struct GraphSlot
+    {
+        enum MixMode { Silent, FadeOut, FadeIn, Mix };
+
+        void prepare (const int numChannels, const int numSamples)
+        {
+            audio.setSize (jmax (1, numChannels), jmax (1, numSamples));
+            midi.ensureSize (4096);
+        }
+
+        void release()
+        {
+            audio.setSize (1, 1);
+            midi.clear();
+        }
+
+        AudioSampleBuffer audio { 1, 1 };
+        MidiBuffer midi;
+        MixMode mix = Silent;
+
+        // inaudible graphs stop rendering once their output has decayed
+        bool dormant = false;
+        int64 silentSamples = 0;
+        int64 inaudibleSamples = 0;
+    };
+
+
+    OwnedArray<GraphSlot> slots;
+    std::unique_ptr<RenderSchedule> schedule;
+    RenderThreadPool* pool = nullptr;
+
+    /** Called after an inaudible graph renders. Puts it to sleep once it's
+        been silent long enough to have finished its fade out and tail */
+    void updateDormancy (const int index, const int numSamples)
+    {
+        // continuous silence needed, at least the graph's tail length
+        const double silenceSeconds = 0.5;
+        // inaudible graphs go dormant after this long even if never silent
+        const double maxTailSeconds = 10.0;
+        // -100 dB
+        const float threshold = 0.00001f;
+
+        auto* const graph = graphs.getUnchecked (index);
+        auto* const slot  = slots.getUnchecked (index);
+        if (slot->dormant)
+            return;
+
+        const auto& audio = slot->audio;
+        bool silent = slot->midi.isEmpty();
+        for (int i = audio.getNumChannels(); --i >= 0 && silent;)
+            silent = audio.getMagnitude (i, 0, numSamples) < threshold;
+
+        slot->silentSamples = silent ? slot->silentSamples + numSamples : 0;
+        slot->inaudibleSamples += numSamples;
+
+        const double sampleRate = graph->getSampleRate() > 0.0 ? graph->getSampleRate() : 44100.0;
+        const double tail = jmax (silenceSeconds, graph->getTailLengthSeconds());
+        if ((double) slot->silentSamples >= tail * sampleRate ||
+            (double) slot->inaudibleSamples >= maxTailSeconds * sampleRate)
+        {
+            slot->dormant = true;
+        }
+    }
+
+    /** Wakes a dormant graph by rendering a block of silence through it and
+        discarding the output. */
+    void warmUp (const int index, const int numChans, const int numSamples)
+    {
+        auto* const slot = slots.getUnchecked (index);
+        slot->audio.setSize (numChans, numSamples, false, false, true);
+        slot->audio.clear (0, numSamples);
+        slot->midi.clear();
+        slot->dormant = false;
+        performStage (index);
+        slot->silentSamples = slot->inaudibleSamples = 0;
+    }
 
-    MidiBuffer midiOut, midiTemp;
+    void updateSchedule()
+    {
+        std::unique_ptr<RenderSchedule> newSchedule (new RenderSchedule());
+        for (int i = 0; i < graphs.size(); ++i)
+            newSchedule->addStage();
+        newSchedule->finalize();
+        schedule.swap (newSchedule);
+    }
 
     void updateIndexes()
     {
@@ -418,15 +593,24 @@ public:
         midiClock.addListener (this);
         graphs.onActiveGraphChanged = std::bind (&AudioEngine::Private::onCurrentGraphChanged, this);
         midiIOMonitor = new MidiIOMonitor();
+        midiOutScheduler.onSend = [this](const MidiMessage& message)
+        {
+            auto& midi (engine.world.getMidiEngine());
+            ScopedLock lockMidiOut (midi.getMidiOutputLock());
+            if (auto* const midiOut = midi.getDefaultMidiOutput())
+                midiOut->sendMessageNow (message);
+        };
         startTimerHz (90);
     }
 
     ~Private()
     {
         graphs.onActiveGraphChanged = nullptr;
+        midiOutScheduler.release();
         midiClock.removeListener (this);
         tempoValue.removeListener (this);
         externalClockValue.removeListener (this);
+        setNumRenderThreads (0);
         
         if (isPrepared)
         {
@@ -512,39 +696,15 @@ public:
         AudioSampleBuffer buffer (channels, totalNumChans, numSamples);
         processCurrentGraph (buffer, incomingMidi);
 
-        {
-            ScopedLock lockMidiOut (engine.world.getMidiEngine().getMidiOutputLock());
-            if (auto* const midiOut = engine.world.getMidiEngine().getDefaultMidiOutput())
-            {
-               #if defined (EL_PRO)
-                if (sendMidiClockToInput.get() != 1 && generateMidiClock.get() == 1)
-                {
-                    if (wasPlaying != transport.isPlaying())
-                    {
-                        if (transport.isPlaying())
-                        {
-                            incomingMidi.addEvent (transport.getPositionFrames() <= 0 
-                                ? MidiMessage::midiStart() : MidiMessage::midiContinue(), 0);
-                        }
-                        else
-                        {
-                            incomingMidi.addEvent (MidiMessage::midiStop(), 0);
-                        }
-                    }
-
-                    midiClockMaster.setTempo (transport.getTempo());
-                    midiClockMaster.render (incomingMidi, numSamples);
-                }
-               #endif
+       #if defined (EL_PRO)
+        if (sendMidiClockToInput.get() != 1 && generateMidiClock.get() == 1)
+            renderMidiClock (incomingMidi, wasPlaying, numSamples);
+       #endif
 
-                const double delayMs = 6.0;
-                if (! incomingMidi.isEmpty())
-                {
-                    midiIOMonitor->sent();
-                    midiOut->sendBlockOfMessages (incomingMidi, delayMs + Time::getMillisecondCounterHiRes(), sampleRate);
-                }
-            }
-        }
+        if (! incomingMidi.isEmpty() && engine.world.getMidiEngine().getDefaultMidiOutput() != nullptr)
+            midiIOMonitor->sent();
+        midiOutScheduler.setLookahead (engine.world.getMidiEngine().getMidiOutputLookahead());
+        midiOutScheduler.scheduleBlock (incomingMidi, numSamples);
         
         incomingMidi.clear();
     }
@@ -553,32 +713,21 @@ public:
     {
         const int numSamples = buffer.getNumSamples();
         messageCollector.removeNextBlockOfMessages (midi, numSamples);
+        engine.world.getMidiEngine().collectMidiInputs (midi, numSamples);
         
         const ScopedLock sl (lock);
         const bool shouldProcess = shouldBeLocked.get() == 0;
         const bool wasPlaying = transport.isPlaying();
+        if (processMidiClock.get() > 0 && sessionWantsExternalClock.get() > 0)
+            syncToMidiClock (midi, numSamples);
         transport.preProcess (numSamples);
+        blockStartFrame = transport.getPositionFrames();
 
         if (shouldProcess)
         {
            #if defined (EL_PRO)
             if (generateMidiClock.get() == 1 && sendMidiClockToInput.get() == 1)
-            {
-                if (wasPlaying != transport.isPlaying())
-                {
-                    if (transport.isPlaying())
-                    {
-                        midi.addEvent (transport.getPositionFrames() <= 0 
-                            ? MidiMessage::midiStart() : MidiMessage::midiContinue(), 0);
-                    }
-                    else
-                    {
-                        midi.addEvent (MidiMessage::midiStop(), 0);
-                    }
-                }
-                midiClockMaster.setTempo (static_cast<double> (transport.getTempo()));
-                midiClockMaster.render (midi, numSamples);
-            }
+                renderMidiClock (midi, wasPlaying, numSamples);
            #endif
 
             if (currentGraph.get() != graphs.getCurrentGraphIndex())
@@ -597,6 +746,72 @@ public:
         
         transport.postProcess (numSamples);
     }
+
+   #if defined (EL_PRO)
+    void renderMidiClock (MidiBuffer& midi, const bool wasPlaying, const int numSamples)
+    {
+        const bool playing = transport.isPlaying();
+        const bool relocated = blockStartFrame != nextMidiClockFrame && ! isUsingExternalClock();
+
+        if (playing != wasPlaying || relocated)
+        {
+            if (wasPlaying)
+                midi.addEvent (MidiMessage::midiStop(), 0);
+
+            if (playing && blockStartFrame <= 0)
+            {
+                midiClockMaster.seek (0.0);
+                midi.addEvent (MidiMessage::midiStart(), 0);
+            }
+            else
+            {
+                // let downstream gear relocate before it resumes
+                const double beats = (double) blockStartFrame * transport.getTempo() / (60.0 * sampleRate);
+                midi.addEvent (MidiMessage::songPositionPointer (midiClockMaster.seek (beats)), 0);
+                if (playing)
+                    midi.addEvent (MidiMessage::midiContinue(), 0);
+            }
+        }
+
+        midiClockMaster.setTempo (static_cast<double> (transport.getTempo()));
+        midiClockMaster.render (midi, numSamples);
+        nextMidiClockFrame = blockStartFrame + (playing ? numSamples : 0);
+    }
+   #endif
+
+    void syncToMidiClock (const MidiBuffer& midi, const int numSamples)
+    {
+        MidiBuffer::Iterator iter (midi);
+        const uint8* data = nullptr;
+        int numBytes = 0, frame = 0;
+        while (iter.getNextEvent (data, numBytes, frame))
+        {
+            // clock, start, continue, stop and song position are system messages
+            if (numBytes <= 0 || data[0] < 0xf0)
+                continue;
+
+            const MidiMessage message (data, numBytes);
+            if (message.isMidiStart())
+            {
+                transport.requestPlayState (true);
+                transport.requestAudioFrame (0);
+            }
+            else if (message.isMidiStop())
+            {
+                transport.requestPlayState (false);
+            }
+            else if (message.isMidiContinue())
+            {
+                transport.requestPlayState (true);
+            }
+
+            midiClock.process (message, frame);
+        }
+
+        if (midiClock.isLocked())
+            transport.requestClockSync (midiClock.getTempo(), midiClock.getSongPosition(), sampleRate);
+        midiClock.advance (numSamples);
+    }
     
     bool isTimeMaster() const
     {
@@ -614,6 +829,10 @@ public:
         const int numChansIn       = device->getActiveInputChannels().countNumberOfSetBits();
         const int numChansOut      = device->getActiveOutputChannels().countNumberOfSetBits();
         audioAboutToStart (newSampleRate, newBlockSize, numChansIn, numChansOut);
+
+        auto& midi (engine.world.getMidiEngine());
+        midi.setAudioOutputLatency (device->getOutputLatencyInSamples() + newBlockSize);
+        midiOutScheduler.prepare (newSampleRate, midi.getAudioOutputLatency());
     }
     
     void audioAboutToStart (const double newSampleRate, const int newBlockSize,
@@ -628,10 +847,11 @@ public:
         
         midiClock.reset (sampleRate, blockSize);
         messageCollector.reset (sampleRate);
+        engine.world.getMidiEngine().prepareMidiInputs (sampleRate);
         keyboardState.addListener (&messageCollector);
         channels.calloc ((size_t) jmax (numChansIn, numChansOut) + 2);
         
-        graphs.prepareBuffers (numInputChans, numOutputChans, blockSize);
+        graphs.prepareBuffers (numInputChans, numOutputChans, jmax (blockSize, maxBlockSize));
 
         if (isPrepared)
         {
@@ -645,6 +865,7 @@ public:
     
     void audioDeviceStopped() override
     {
+        midiOutScheduler.release();
         audioStopped();
     }
     
@@ -661,29 +882,14 @@ public:
         graphs.releaseBuffers();
     }
     
-    void handleIncomingMidiMessage (MidiInput*, const MidiMessage& message) override
+    void handleIncomingMidiMessage (MidiInput* source, const MidiMessage& message) override
     {
         if (! message.isActiveSense() && ! message.isMidiClock())
             midiIOMonitor->received();
-        messageCollector.addMessageToQueue (message);
-        const bool clockWanted = processMidiClock.get() > 0 && sessionWantsExternalClock.get() > 0;
-        if (clockWanted && message.isMidiClock())
-        {
-            midiClock.process (message);
-        }
-        else if (clockWanted && message.isMidiStart())
-        {
-            transport.requestPlayState (true);
-            transport.requestAudioFrame (0);
-        }
-        else if (clockWanted && message.isMidiStop())
-        {
-            transport.requestPlayState (false);
-        }
-        else if (clockWanted && message.isMidiContinue())
-        {
-            transport.requestPlayState (true);
-        }   
+        // device input reaches the graph through the MidiEngine's input queues
+        // MIDI clock is handled on the audio thread, see syncToMidiClock()
+        if (source == nullptr)
+            messageCollector.addMessageToQueue (message);
     }
     
     void addGraph (RootGraph* graph)
@@ -692,6 +898,7 @@ public:
         if (isPrepared)
             prepareGraph (graph, sampleRate, blockSize);
         ScopedLock sl (lock);
+        graph->setRenderThreadPool (renderPool.get());
         if (graphs.addGraph (graph))
         {
             graph->renderingSequenceChanged.connect (
@@ -704,6 +911,7 @@ public:
         {
             ScopedLock sl (lock);
             graphs.removeGraph (graph);
+            graph->setRenderThreadPool (nullptr);
         }
         
         graph->renderingSequenceChanged.disconnect_all_slots();
@@ -757,19 +965,52 @@ public:
         }
     }
     
+    void setNumRenderThreads (const int numThreads)
+    {
+        const int numWorkers = renderPool != nullptr ? renderPool->getNumWorkers() : 0;
+        if (numThreads == numWorkers)
+            return;
+
+        std::unique_ptr<RenderThreadPool> newPool;
+        if (numThreads > 0)
+            newPool.reset (new RenderThreadPool (numThreads));
+
+        {
+            ScopedLock sl (lock);
+            renderPool.swap (newPool);
+            graphs.setRenderThreadPool (renderPool.get());
+            for (auto* const graph : graphs.getGraphs())
+                graph->setRenderThreadPool (renderPool.get());
+        }
+
+        // old pool is deleted here, after the graphs stopped using it
+    }
+
     void resetMidiClock()
     {
+        const ScopedLock sl (lock);
         midiClock.reset (sampleRate, blockSize);
+        transport.getMonitor()->clockLocked.set (false);
     }
     
-    void midiClockTempoChanged (const float bpm) override
+    // tempo and phase are applied by the transport on the audio thread
+    void midiClockTempoChanged (const float) override { }
+    
+    void midiClockSignalAcquired() override
     {
-        if (sessionWantsExternalClock.get() > 0 && processMidiClock.get() > 0)
-            transport.requestTempo (bpm);
+        transport.getMonitor()->clockLocked.set (true);
+    }
+
+    void midiClockSignalDropped() override
+    {
+        transport.getMonitor()->clockLocked.set (false);
+        transport.getMonitor()->clockJitter.set (0.0);
+    }
+
+    void midiClockJitterChanged (const double jitterMs) override
+    {
+        transport.getMonitor()->clockJitter.set (jitterMs);
     }
-    
-    void midiClockSignalAcquired()  override { }
-    void midiClockSignalDropped()   override { }
     
     bool isUsingExternalClock() const
     {
@@ -793,6 +1034,7 @@ private:
     CriticalSection     lock;
     double sampleRate   = 0.0;
     int blockSize       = 0;
+    int maxBlockSize    = 0;
     bool isPrepared     = false;
     Atomic<int> currentGraph;
 
@@ -802,6 +1044,7 @@ private:
     MidiBuffer incomingMidi;
     MidiMessageCollector messageCollector;
     MidiKeyboardState keyboardState;
+    MidiOutputScheduler midiOutScheduler;
 
     AudioSampleBuffer graphBuffer;
     AudioSampleBuffer graphMixBuffer;
@@ -814,6 +1057,8 @@ private:
 
     MidiClock midiClock;
     MidiClockMaster midiClockMaster;
+    int64 blockStartFrame = 0;
+    int64 nextMidiClockFrame = 0;
     
     AudioPlayHead::CurrentPositionInfo hostPos, lastHostPos;
     
@@ -823,12 +1068,14 @@ private:
     Atomic<int> shouldBeLocked { 0 };
 
     MidiIOMonitorPtr midiIOMonitor;
+    std::unique_ptr<RenderThreadPool> renderPool;
 
     void prepareGraph (RootGraph* graph, double sampleRate, int estimatedBlockSize)
     {
         graph->setPlayConfigDetails (numInputChans, numOutputChans,
                                      sampleRate, blockSize);
         graph->setPlayHead (&transport);
+        graph->setMaximumBlockSize (maxBlockSize);
         graph->prepareToPlay (sampleRate, estimatedBlockSize);
     }
     
@@ -895,6 +1142,7 @@ void AudioEngine::applySettings (Settings& settings)
     priv->processMidiClock.set (useMidiClock ? 1 : 0);
     priv->generateMidiClock.set (settings.generateMidiClock() ? 1 : 0);
     priv->sendMidiClockToInput.set (settings.sendMidiClockToInput() ? 1 : 0);
+    priv->setNumRenderThreads (settings.getNumRenderThreads());
 }
 
 bool AudioEngine::removeGraph (RootGraph* graph)
@@ -991,6 +1239,12 @@ void AudioEngine::prepareExternalPlayback (const double sampleRate, const int bl
         priv->audioAboutToStart (sampleRate, blockSize, numIns, numOuts);
 }
 
+void AudioEngine::setMaximumBlockSize (const int maxBlockSize)
+{
+    if (priv)
+        priv->maxBlockSize = jmax (0, maxBlockSize);
+}
+
 void AudioEngine::processExternalBuffers (AudioBuffer<float>& buffer, MidiBuffer& midi)
 {
     if (priv)
@@ -178,6 +178,13 @@ public:
      */
     void prepareExternalPlayback (const double sampleRate, const int blockSize,
                                   const int numIns, const int numOuts);
+
+    /** Sets the largest block an external renderer will pass, e.g. for an
+        offline bounce.  Graphs render blocks up to this size in one pass
+        without reallocating.  Call before prepareExternalPlayback(), 0 uses
+        the prepared block size.
+     */
+    void setMaximumBlockSize (int maxBlockSize);
     void processExternalBuffers (AudioBuffer<float>& buffer, MidiBuffer& midi);
     void processExternalPlayhead (AudioPlayHead* playhead, const int nframes);
     void releaseExternalResources();
@@ -38,9 +38,11 @@ GraphNode::GraphNode (const uint32 nodeId_) noexcept
     : nodeId (nodeId_),
       metadata (Tags::node),
       isPrepared (false),
+      parameterNotifier (*this),
       enablement (*this),
       midiProgramLoader (*this),
-      portResetter (*this)
+      portResetter (*this),
+      oversamplingSwitcher (*this)
 {
     parent = nullptr;
     gain.set(1.0f); lastGain.set (1.0f);
@@ -301,8 +303,10 @@ void GraphNode::prepare (const double sampleRate, const int blockSize,
         setParentGraph (parentGraph); //<< ensures io nodes get setup
 
         initOversampling (jmax (getNumPorts (PortType::Audio, true), getNumPorts (PortType::Audio, false)), blockSize);
+        osSampleRate = sampleRate;
+        osState.set (osActive);
 
-        const int osFactor = getOversamplingFactor();
+        const int osFactor = 1 << osPow;
         prepareToRender (sampleRate * osFactor, blockSize * osFactor);
 
         // TODO: move model code out of engine code
@@ -315,6 +319,8 @@ void GraphNode::prepare (const double sampleRate, const int blockSize,
         if (metadata.getProperty (Tags::bypass, false))
             suspendProcessing (true);
 
+        publishParameterUpdates();
+
         inRMS.clearQuick (true);
         for (int i = 0; i < getNumAudioInputs(); ++i)
         {
@@ -338,6 +344,8 @@ void GraphNode::unprepare()
     if (isPrepared)
     {
         isPrepared = false;
+        parameterUpdates.store (nullptr);
+        parameterNotifier.stop();
         inRMS.clear (true);
         outRMS.clear (true);
         resetOversampling();
@@ -345,6 +353,123 @@ void GraphNode::unprepare()
     }
 }
 
+//=============================================================================
+GraphNode::ParameterSlotList::ParameterSlotList (const int numSlots)
+    : next (new std::atomic<int> [(size_t) jmax (1, numSlots)]),
+      linked (new std::atomic<bool> [(size_t) jmax (1, numSlots)])
+{
+    for (int i = 0; i < jmax (1, numSlots); ++i)
+    {
+        next[i].store (-1);
+        linked[i].store (false);
+    }
+}
+
+void GraphNode::ParameterSlotList::push (const int slot) noexcept
+{
+    if (linked[slot].exchange (true))
+        return;
+
+    int oldHead = head.load();
+    do {
+        next[slot].store (oldHead);
+    } while (! head.compare_exchange_weak (oldHead, slot));
+}
+
+GraphNode::ParameterUpdates::ParameterUpdates (const ParameterArray& params)
+    : parameters (params),
+      values (new std::atomic<float> [(size_t) jmax (1, params.size())]),
+      pending (params.size()),
+      changed (params.size())
+{
+    for (int i = 0; i < jmax (1, params.size()); ++i)
+        values[i].store (-1.f);
+}
+
+void GraphNode::publishParameterUpdates()
+{
+    auto* updates = parameterUpdateBlocks.getLast();
+    bool reusable = updates != nullptr && updates->parameters.size() == parameters.size();
+    for (int i = 0; reusable && i < parameters.size(); ++i)
+        reusable = updates->parameters.getObjectPointerUnchecked (i) == parameters.getObjectPointerUnchecked (i);
+
+    // blocks are never deleted while the node lives, a controller thread
+    // might still be writing to an old one
+    if (! reusable)
+        updates = parameterUpdateBlocks.add (new ParameterUpdates (parameters));
+    parameterUpdates.store (updates);
+}
+
+bool GraphNode::queueParameterValue (int index, float value)
+{
+    auto* const updates = parameterUpdates.load();
+    if (updates == nullptr || ! isPositiveAndBelow (index, updates->parameters.size()))
+        return false;
+
+    updates->values[index].store (jlimit (0.f, 1.f, value));
+    updates->pending.push (index);
+    parameterNotifier.request();
+    return true;
+}
+
+void GraphNode::applyParameterUpdates()
+{
+    auto* const updates = parameterUpdates.load();
+    if (updates == nullptr)
+        return;
+
+    // only the slots written since the last block are visited, listeners are
+    // told about the new values later on the message thread
+    updates->pending.takeAll ([updates] (const int slot)
+    {
+        const float value = updates->values[slot].exchange (-1.f);
+        if (value < 0.f)
+            return;
+
+        updates->parameters.getObjectPointerUnchecked (slot)->setValue (value);
+        updates->changed.push (slot);
+    });
+}
+
+void GraphNode::ParameterNotifier::stop()
+{
+    stopTimer();
+    cancelPendingUpdate();
+    requested.store (false);
+}
+
+void GraphNode::ParameterNotifier::timerCallback()
+{
+    auto* const updates = node.parameterUpdates.load();
+    if (updates == nullptr)
+    {
+        stop();
+        return;
+    }
+
+    bool notified = false;
+    updates->changed.takeAll ([updates, &notified] (const int slot)
+    {
+        auto* const param = updates->parameters.getObjectPointerUnchecked (slot);
+        param->beginChangeGesture();
+        param->sendValueChangedMessageToListeners (param->getValue());
+        param->endChangeGesture();
+        notified = true;
+    });
+
+    idleTicks = notified ? 0 : idleTicks + 1;
+    if (idleTicks < 30)
+        return;
+
+    // a value queued before the flag was cleared restarts the timer here,
+    // one queued after it requests a restart itself
+    stopTimer();
+    requested.store (false);
+    if (! updates->pending.isEmpty() || ! updates->changed.isEmpty())
+        request();
+}
+
+//=============================================================================
 void GraphNode::setEnabled (const bool shouldBeEnabled)
 {
     if (shouldBeEnabled == isEnabled())
@@ -361,7 +486,7 @@ void GraphNode::setEnabled (const bool shouldBeEnabled)
     {
         if (parent)
         {
-            prepare (parent->getSampleRate(), parent->getBlockSize(), parent, true);
+            prepare (parent->getSampleRate(), parent->getRenderBlockSize(), parent, true);
             enabled.set (1);
         }
         else
@@ -385,6 +510,44 @@ void GraphNode::EnablementUpdater::handleAsyncUpdate()
 
 //=============================================================================
 
+uint64 GraphNode::MidiFilter::pack() const noexcept
+{
+    return  (uint64) (keyLow & 0x7f)
+         | ((uint64) (keyHigh & 0x7f) << 7)
+         | ((uint64) ((transpose + 128) & 0xff) << 14)
+         | ((uint64) (channels & 0xffff) << 22)
+         | ((uint64) (omni ? 1 : 0) << 38)
+         | ((uint64) (programsEnabled ? 1 : 0) << 39);
+}
+
+GraphNode::MidiFilter GraphNode::MidiFilter::unpack (const uint64 bits) noexcept
+{
+    MidiFilter filter;
+    filter.keyLow           = (int) (bits & 0x7f);
+    filter.keyHigh          = (int) ((bits >> 7) & 0x7f);
+    filter.transpose        = (int) ((bits >> 14) & 0xff) - 128;
+    filter.channels         = (uint32) ((bits >> 22) & 0xffff);
+    filter.omni             = ((bits >> 38) & 1) != 0;
+    filter.programsEnabled  = ((bits >> 39) & 1) != 0;
+    return filter;
+}
+
+void GraphNode::setMidiChannels (const BigInteger& ch)
+{
+    ScopedLock sl (propertyLock);
+    midiChannels.setChannels (ch);
+
+    uint32 mask = 0;
+    for (int channel = 1; channel <= 16; ++channel)
+        if (midiChannels.isOn (channel))
+            mask |= (1u << (channel - 1));
+
+    const bool omni = midiChannels.isOmni();
+    updateMidiFilter ([=](MidiFilter& f) { f.channels = mask; f.omni = omni; });
+}
+
+//=============================================================================
+
 void GraphNode::reloadMidiProgram()
 {
     midiProgramLoader.triggerAsyncUpdate();
@@ -704,45 +867,81 @@ void GraphNode::setMuted (bool muted)
 
 void GraphNode::initOversampling (int numChannels, int blockSize)
 {
-    osProcessors.clear();
-    numChannels = jmax (1, numChannels); // avoid assertion on nodes that don't have audio
-    for (int pow = 1; pow <= maxOsPow; ++pow)
-        osProcessors.add (new dsp::Oversampling<float> (numChannels, pow, dsp::Oversampling<float>::FilterType::filterHalfBandPolyphaseIIR));
+    osNumChannels = jmax (1, numChannels); // avoid assertion on nodes that don't have audio
+    osBlockSize = blockSize;
+    osPow = requestedOsPow.get();
+    osLatency = 0.0f;
+    oversampler.reset();
 
-    prepareOversampling (blockSize);
+    // only the selected factor is created, nodes that don't oversample have none
+    if (osPow > 0)
+    {
+        oversampler.reset (new dsp::Oversampling<float> (osNumChannels, osPow,
+            dsp::Oversampling<float>::FilterType::filterHalfBandPolyphaseIIR));
+        oversampler->initProcessing ((size_t) blockSize);
+        osLatency = oversampler->getLatencyInSamples();
+    }
 }
 
-void GraphNode::prepareOversampling (int blockSize)
+void GraphNode::resetOversampling()
 {
-    for (auto* osProcessor : osProcessors)
-        osProcessor->initProcessing (blockSize);
+    oversamplingSwitcher.stopTimer();
+    osState.set (osActive);
+    if (oversampler != nullptr)
+        oversampler->reset();
 }
 
-void GraphNode::resetOversampling()
+void GraphNode::switchOversampling()
 {
-    for (auto* osProcessor : osProcessors)
-        osProcessor->reset();
+    jassert (osState.get() == osSwitching);
+    const float lastLatency = osLatency;
+
+    releaseResources();
+    initOversampling (osNumChannels, osBlockSize);
+    const int osFactor = 1 << osPow;
+    prepareToRender (osSampleRate * osFactor, osBlockSize * osFactor);
+    osState.set (osFadingIn);
+
+    // delay compensation in the graph depends on this node's latency
+    if (osLatency != lastLatency && parent != nullptr)
+        parent->triggerAsyncUpdate();
 }
 
-dsp::Oversampling<float>* GraphNode::getOversamplingProcessor()
+void GraphNode::OversamplingSwitcher::timerCallback()
 {
-    return osProcessors[osPow-1];
+    // only the audio thread moves a fade to osSwitching, after its last block
+    // with the old oversampler. Until then keep polling, or stop if prepare()
+    // or unprepare() already reset the node
+    const int state = node.osState.get();
+    if (state != osSwitching)
+    {
+        if (state != osFadingOut)
+            stopTimer();
+        return;
+    }
+
+    stopTimer();
+    node.switchOversampling();
 }
 
 void GraphNode::setOversamplingFactor (int osFactor)
 {
-    osPow = (int) log2f ((float) osFactor);
-    if (auto* osProc = getOversamplingProcessor())
-        osLatency = osProc->getLatencyInSamples();
+    const int newPow = jlimit (0, maxOsPow, (int) log2f ((float) jmax (1, osFactor)));
+    if (requestedOsPow.get() == newPow)
+        return;
+
+    requestedOsPow.set (newPow);
+    if (! isPrepared)
+        return;
+
+    if (osState.get() != osSwitching)
+        osState.set (osFadingOut);
+    oversamplingSwitcher.start();
 }
 
 int GraphNode::getOversamplingFactor()
 {
-    if (osPow > 0)
-        if (auto* osProc = getOversamplingProcessor())
-            return static_cast<int> (osProc->getOversamplingFactor());
-
-    return 1;
+    return 1 << requestedOsPow.get();
 }
 
 //=========================================================================
@@ -91,6 +91,15 @@ public:
     //=========================================================================
     const ParameterArray& getParameters() const    { return parameters; }
 
+    /** Queues a new value for a parameter from any thread.  Values queued
+        between audio blocks are coalesced, only the latest for each parameter
+        is applied on the audio thread before this node renders.
+
+        Returns false if the node isn't prepared to render, in which case the
+        caller should set the parameter itself.
+     */
+    bool queueParameterValue (int parameterIndex, float value);
+
     //=========================================================================
     /** Returns the type of port
         
@@ -199,6 +208,16 @@ public:
        this will return nullptr */
     GraphProcessor* getParentGraph() const;
 
+    /** Turns on level metering. Levels are only measured while something is
+        displaying them, call stopMetering() once for each call to this */
+    void startMetering() noexcept                { ++meterRefs; }
+
+    /** Turns off level metering when there are no more users of it */
+    void stopMetering() noexcept                 { jassert (meterRefs.get() > 0); --meterRefs; }
+
+    /** True if levels are being measured */
+    bool isMetering() const noexcept             { return meterRefs.get() > 0; }
+
     void setInputRMS (int chan, float val);
     float getInputRMS(int chan) const { return (chan < inRMS.size()) ? inRMS.getUnchecked(chan)->get() : 0.0f; }
     void setOutputRMS (int chan, float val);
@@ -215,27 +234,50 @@ public:
     /** Returns true if this node is enabled */
     inline bool isEnabled()  const { return enabled.get() == 1; }
 
+    //=========================================================================
+    /** The MIDI filter settings applied while rendering.  They are packed
+        into a single word so the audio thread can read a consistent copy
+        without locking.
+     */
+    struct MidiFilter
+    {
+        int keyLow = 0, keyHigh = 127;
+        int transpose = 0;
+        uint32 channels = 0xffff;   // bit n is MIDI channel n + 1
+        bool omni = true;
+        bool programsEnabled = false;
+
+        inline Range<int> getKeyRange() const noexcept { return { keyLow, keyHigh }; }
+        inline bool isOff (const int channel) const noexcept { return (channels & (1u << (channel - 1))) == 0; }
+
+        uint64 pack() const noexcept;
+        static MidiFilter unpack (uint64 bits) noexcept;
+    };
+
+    /** Returns a snapshot of the MIDI filter settings, safe to call from any thread */
+    inline MidiFilter getMidiFilter() const noexcept { return MidiFilter::unpack (midiFilter.load (std::memory_order_acquire)); }
+
     //=========================================================================
     inline void setKeyRange (const int low, const int high)
     {
         jassert (low <= high);
         jassert (isPositiveAndBelow (low, 128));
         jassert (isPositiveAndBelow (high, 128));
-        keyRangeLow.set (low); keyRangeHigh.set (high);
+        updateMidiFilter ([=](MidiFilter& f) { f.keyLow = low; f.keyHigh = high; });
     }
 
     inline void setKeyRange (const Range<int>& range) { setKeyRange (range.getStart(), range.getEnd()); }
 
-    inline Range<int> getKeyRange() const { return Range<int> { keyRangeLow.get(), keyRangeHigh.get() }; }
+    inline Range<int> getKeyRange() const { return getMidiFilter().getKeyRange(); }
 
     //=========================================================================
     inline void setTransposeOffset (const int value)
     {
         jassert (value >= -24 && value <= 24);
-        transposeOffset.set (value);
+        updateMidiFilter ([=](MidiFilter& f) { f.transpose = value; });
     }
 
-    inline int getTransposeOffset() const { return transposeOffset.get(); }
+    inline int getTransposeOffset() const { return getMidiFilter().transpose; }
 
     const CriticalSection& getPropertyLock() const { return propertyLock; }
 
@@ -251,10 +293,10 @@ public:
 
     /** True if MIDI programs should be loaded when Program change messages
         are received */
-    inline bool areMidiProgramsEnabled() const         { return midiProgramsEnabled.get() == 1; }
+    inline bool areMidiProgramsEnabled() const         { return getMidiFilter().programsEnabled; }
 
     /** Enable or disable changing midi programs */
-    inline void setMidiProgramsEnabled (bool enabled)  { midiProgramsEnabled.set (enabled ? 1 : 0); }
+    inline void setMidiProgramsEnabled (bool enabled)  { updateMidiFilter ([=](MidiFilter& f) { f.programsEnabled = enabled; }); }
 
     /** Returns the active midi program */
     inline int getMidiProgram() const                  { return midiProgram.get(); }
@@ -288,11 +330,7 @@ public:
     void setMidiProgramsState (const String& state);
 
     //=========================================================================
-    inline void setMidiChannels (const BigInteger& ch)
-    {
-        ScopedLock sl (propertyLock);
-        midiChannels.setChannels (ch);
-    }
+    void setMidiChannels (const BigInteger& ch);
 
     inline const MidiChannels& getMidiChannels() const { return midiChannels; }
 
@@ -320,6 +358,7 @@ public:
 
     inline virtual void setCurrentProgram (int index)
     {
+        markStateDirty();
         if (auto* const proc = getAudioProcessor())
             return proc->setCurrentProgram (index);
     }
@@ -334,6 +373,16 @@ public:
     virtual void getState (MemoryBlock&) = 0;
     virtual void setState (const void*, int sizeInBytes) = 0;
 
+    /** Returns true if the state may have changed since it was last saved or
+        restored. Nodes that don't report their changes are always dirty */
+    inline bool isStateDirty() const noexcept { return stateTracked.get() == 0 || stateDirty.get() != 0; }
+
+    /** Flags the state as changed, this can be called from any thread */
+    inline void markStateDirty() noexcept { stateDirty.set (1); }
+
+    /** Flags the state as saved */
+    inline void markStateClean() noexcept { stateDirty.set (0); }
+
     //=========================================================================
     void setOversamplingFactor (int osFactor);
     int getOversamplingFactor();
@@ -381,6 +430,9 @@ protected:
     //=========================================================================
     void triggerPortReset();
 
+    /** Subclasses call this if they mark the state dirty whenever it changes */
+    void setStateChangesTracked (bool tracked) noexcept { stateTracked.set (tracked ? 1 : 0); }
+
     kv::PortList ports;
     ValueTree metadata;
 
@@ -393,6 +445,8 @@ private:
     
     GraphProcessor* parent = nullptr;
     bool isPrepared = false;
+    Atomic<int> stateDirty { 1 };
+    Atomic<int> stateTracked { 0 };
     Atomic<int> enabled { 1 };
     Atomic<int> bypassed { 0 };
     Atomic<int> mute { 0 };
@@ -403,17 +457,88 @@ private:
 
     ParameterArray parameters;
 
+    /** Lock-free list of parameter slots, each linked at most once.  Any thread
+        can push, a single thread takes them all. */
+    struct ParameterSlotList
+    {
+        explicit ParameterSlotList (int numSlots);
+        void push (int slot) noexcept;
+        bool isEmpty() const noexcept { return head.load() < 0; }
+
+        template<class Callback>
+        void takeAll (Callback&& callback) noexcept
+        {
+            if (head.load() < 0)
+                return;
+            for (int slot = head.exchange (-1); slot >= 0;)
+            {
+                const int nextSlot = next[slot].load();
+                linked[slot].store (false);
+                callback (slot);
+                slot = nextSlot;
+            }
+        }
+
+    private:
+        std::unique_ptr<std::atomic<int>[]> next;
+        std::unique_ptr<std::atomic<bool>[]> linked;
+        std::atomic<int> head { -1 };
+    };
+
+    /** Pending controller values for the parameters captured at prepare time.
+        Controllers fill 'pending', the audio thread sets the values and fills
+        'changed', the message thread then notifies the parameter listeners */
+    struct ParameterUpdates
+    {
+        explicit ParameterUpdates (const ParameterArray&);
+        ParameterArray parameters;
+        std::unique_ptr<std::atomic<float>[]> values;
+        ParameterSlotList pending, changed;
+    };
+
+    std::atomic<ParameterUpdates*> parameterUpdates { nullptr };
+    OwnedArray<ParameterUpdates> parameterUpdateBlocks; // kept until destruction
+    void publishParameterUpdates();
+    void applyParameterUpdates();
+
+    /** Runs on the message thread only while queued values are in flight. It
+        is started by the first queued value and stops once things go quiet */
+    struct ParameterNotifier : public Timer,
+                               public AsyncUpdater
+    {
+        ParameterNotifier (GraphNode& n) : node (n) { }
+        ~ParameterNotifier() { stop(); }
+        void request() noexcept { if (! requested.exchange (true)) triggerAsyncUpdate(); }
+        void stop();
+        void handleAsyncUpdate() override { idleTicks = 0; startTimerHz (30); }
+        void timerCallback() override;
+        GraphNode& node;
+        std::atomic<bool> requested { false };
+        int idleTicks = 0;
+    } parameterNotifier;
+
     Atomic<float> gain, lastGain, inputGain, lastInputGain;
     OwnedArray<AtomicValue<float> > inRMS, outRMS;
+    Atomic<int> meterRefs { 0 };
     
-    Atomic<int> keyRangeLow { 0 };
-    Atomic<int> keyRangeHigh { 127 };
-    Atomic<int> transposeOffset { 0 };
+    std::atomic<uint64> midiFilter { MidiFilter().pack() };
     MidiChannels midiChannels;
 
+    template<typename Fn>
+    void updateMidiFilter (Fn&& update)
+    {
+        auto current = midiFilter.load (std::memory_order_relaxed);
+        for (;;)
+        {
+            auto filter = MidiFilter::unpack (current);
+            update (filter);
+            if (midiFilter.compare_exchange_weak (current, filter.pack(), std::memory_order_acq_rel))
+                break;
+        }
+    }
+
     Atomic<int> midiProgram { 0 };
     Atomic<int> lastMidiProgram { -1 };
-    Atomic<int> midiProgramsEnabled { 0 };
     Atomic<int> globalMidiPrograms { 0 };
 
     CriticalSection propertyLock;
@@ -456,17 +581,33 @@ private:
     void unprepare();
     void resetPorts();
     void initOversampling (int numChannels, int blockSize);
-    void prepareOversampling (int blockSize);
     void resetOversampling();
-    dsp::Oversampling<float>* getOversamplingProcessor();
+    void switchOversampling();
+    dsp::Oversampling<float>* getOversamplingProcessor() const noexcept { return oversampler.get(); }
 
     Parameter::Ptr getOrCreateParameter (const PortDescription&);
 
+    // Changing the factor of a prepared node fades it out on the audio thread,
+    // swaps the oversampler on the message thread, then fades back in
+    enum OversamplingState { osActive = 0, osFadingOut, osSwitching, osFadingIn };
+    Atomic<int> osState { osActive };
+    Atomic<int> requestedOsPow { 0 };
     int osPow = 0;
     float osLatency = 0.0f;
-    OwnedArray<dsp::Oversampling<float>> osProcessors;
+    int osNumChannels = 1, osBlockSize = 0;
+    double osSampleRate = 0.0;
+    std::unique_ptr<dsp::Oversampling<float>> oversampler;
     const int maxOsPow = 3;
 
+    struct OversamplingSwitcher : public Timer
+    {
+        OversamplingSwitcher (GraphNode& n) : node (n) { }
+        ~OversamplingSwitcher() { stopTimer(); }
+        void start() { startTimer (10); }
+        void timerCallback() override;
+        GraphNode& node;
+    } oversamplingSwitcher;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GraphNode)
 };
 
@@ -20,8 +20,9 @@
 #include "engine/nodes/AudioProcessorNode.h"
 #include "engine/AudioEngine.h"
 #include "engine/GraphProcessor.h"
+#include "engine/MidiFilterTable.h"
 #include "engine/MidiPipe.h"
-#include "engine/MidiTranspose.h"
+#include "engine/RenderThreadPool.h"
 #include "engine/nodes/SubGraphProcessor.h"
 #include "session/Node.h"
 
@@ -32,6 +33,23 @@ const int GraphProcessor::midiChannelIndex = 0x1000;
 namespace GraphRender
 {
 
+/** The shared buffers touched by a render task. Used to find the
+    dependencies between stages when rendering in parallel */
+struct BufferUsage
+{
+    /** Pseudo resource for tasks which touch the graph's own IO buffers */
+    enum { graphIO = -1 };
+
+    static int audio (const int index) noexcept    { return index << 1; }
+    static int midi (const int index) noexcept     { return (index << 1) | 1; }
+
+    void read (const int resource)                  { reads.addIfNotAlreadyThere (resource); }
+    void write (const int resource)                 { writes.addIfNotAlreadyThere (resource); }
+    void readWrite (const int resource)             { read (resource); write (resource); }
+
+    Array<int> reads, writes;
+};
+
 class Task
 {
 public:
@@ -42,6 +60,12 @@ public:
                           const OwnedArray <MidiBuffer>& sharedMidiBuffers,
                           const int numSamples) = 0;
 
+    /** Report which shared buffers are read and written by perform() */
+    virtual void getBufferUsage (BufferUsage&) const = 0;
+
+    /** True if this task renders a node. Parallel stages end with one of these */
+    virtual bool isNodeTask() const { return false; }
+
     JUCE_LEAK_DETECTOR (Task);
 };
 
@@ -57,6 +81,11 @@ public:
         sharedBufferChans.clear (channelNum, 0, numSamples);
     }
 
+    void getBufferUsage (BufferUsage& usage) const
+    {
+        usage.write (BufferUsage::audio (channelNum));
+    }
+
 private:
     const int channelNum;
 
@@ -77,6 +106,12 @@ public:
         sharedBufferChans.copyFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
     }
 
+    void getBufferUsage (BufferUsage& usage) const
+    {
+        usage.read (BufferUsage::audio (srcChannelNum));
+        usage.write (BufferUsage::audio (dstChannelNum));
+    }
+
 private:
     const int srcChannelNum, dstChannelNum;
 
@@ -97,6 +132,12 @@ public:
         sharedBufferChans.addFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
     }
 
+    void getBufferUsage (BufferUsage& usage) const
+    {
+        usage.read (BufferUsage::audio (srcChannelNum));
+        usage.readWrite (BufferUsage::audio (dstChannelNum));
+    }
+
 private:
     const int srcChannelNum, dstChannelNum;
 
@@ -116,6 +157,11 @@ public:
         sharedMidiBuffers.getUnchecked (bufferNum)->clear();
     }
 
+    void getBufferUsage (BufferUsage& usage) const
+    {
+        usage.write (BufferUsage::midi (bufferNum));
+    }
+
 private:
     const int bufferNum;
 
@@ -126,18 +172,29 @@ private:
 class CopyMidiBufferOp : public Task
 {
 public:
-    CopyMidiBufferOp (const int srcBufferNum_, const int dstBufferNum_)
+    CopyMidiBufferOp (const int srcBufferNum_, const int dstBufferNum_, Atomic<int>& droppedEvents_)
         : srcBufferNum (srcBufferNum_),
-          dstBufferNum (dstBufferNum_)
+          dstBufferNum (dstBufferNum_),
+          droppedEvents (droppedEvents_)
     { }
 
-    void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int)
+    void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
     {
-        *sharedMidiBuffers.getUnchecked (dstBufferNum) = *sharedMidiBuffers.getUnchecked (srcBufferNum);
+        const int numDropped = MidiPipe::copyEvents (*sharedMidiBuffers.getUnchecked (dstBufferNum),
+                                                     *sharedMidiBuffers.getUnchecked (srcBufferNum), numSamples);
+        if (numDropped > 0)
+            droppedEvents += numDropped;
+    }
+
+    void getBufferUsage (BufferUsage& usage) const
+    {
+        usage.read (BufferUsage::midi (srcBufferNum));
+        usage.write (BufferUsage::midi (dstBufferNum));
     }
 
 private:
     const int srcBufferNum, dstBufferNum;
+    Atomic<int>& droppedEvents;
 
     JUCE_DECLARE_NON_COPYABLE (CopyMidiBufferOp)
 };
@@ -146,19 +203,30 @@ private:
 class AddMidiBufferOp : public Task
 {
 public:
-    AddMidiBufferOp (const int srcBufferNum_, const int dstBufferNum_)
+    AddMidiBufferOp (const int srcBufferNum_, const int dstBufferNum_, Atomic<int>& droppedEvents_)
         : srcBufferNum (srcBufferNum_),
-          dstBufferNum (dstBufferNum_)
+          dstBufferNum (dstBufferNum_),
+          droppedEvents (droppedEvents_)
     { }
 
     void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
     {
-        sharedMidiBuffers.getUnchecked (dstBufferNum)
-            ->addEvents (*sharedMidiBuffers.getUnchecked (srcBufferNum), 0, numSamples, 0);
+        const int numDropped = MidiPipe::addEvents (*sharedMidiBuffers.getUnchecked (dstBufferNum),
+                                                    *sharedMidiBuffers.getUnchecked (srcBufferNum),
+                                                    0, numSamples, 0);
+        if (numDropped > 0)
+            droppedEvents += numDropped;
+    }
+
+    void getBufferUsage (BufferUsage& usage) const
+    {
+        usage.read (BufferUsage::midi (srcBufferNum));
+        usage.readWrite (BufferUsage::midi (dstBufferNum));
     }
 
 private:
     const int srcBufferNum, dstBufferNum;
+    Atomic<int>& droppedEvents;
 
     JUCE_DECLARE_NON_COPYABLE (AddMidiBufferOp)
 };
@@ -188,6 +256,11 @@ public:
         }
     }
 
+    void getBufferUsage (BufferUsage& usage) const
+    {
+        usage.readWrite (BufferUsage::audio (channel));
+    }
+
 private:
     HeapBlock<float> buffer;
     const int channel, bufferSize;
@@ -197,6 +270,9 @@ private:
 };
 
 
+/** How often node levels are measured, in Hz */
+static const double meterRefreshRate = 30.0;
+
 class ProcessBufferOp : public Task
 {
 public:
@@ -204,7 +280,8 @@ public:
                      const Array <int>& audioChannelsToUse_,
                      const int totalChans_,
                      const int midiBufferToUse_,
-                     const Array <int> chans [PortType::Unknown])
+                     const Array <int> chans [PortType::Unknown],
+                     Atomic<int>& droppedMidiEvents_)
         : node (node_),
           processor (node_->getAudioPluginInstance()),
           audioChannelsToUse (audioChannelsToUse_),
@@ -212,9 +289,19 @@ public:
           totalChans (jmax (1, totalChans_)),
           numAudioIns (node_->getNumPorts (PortType::Audio, true)),
           numAudioOuts (node_->getNumPorts (PortType::Audio, false)),
-          midiBufferToUse (midiBufferToUse_)
+          midiBufferToUse (midiBufferToUse_),
+          droppedMidiEvents (droppedMidiEvents_)
     {
         channels.calloc ((size_t) totalChans);
+        osChannels.calloc ((size_t) totalChans);
+        levels.calloc ((size_t) totalChans);
+
+        if (auto* const graph = node->getParentGraph())
+        {
+            if (graph->getSampleRate() > 0.0)
+                meterInterval = roundToInt (graph->getSampleRate() / meterRefreshRate);
+            tempMidi.ensureSize ((size_t) MidiPipe::getBufferSizeForBlockSize (graph->getRenderBlockSize()));
+        }
 
         while (audioChannelsToUse.size() < totalChans)
             audioChannelsToUse.add (0);
@@ -227,12 +314,14 @@ public:
 
     void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
     {
+        jassert (numSamples <= sharedBufferChans.getNumSamples());
         for (int i = totalChans; --i >= 0;) {
             channels[i] = sharedBufferChans.getWritePointer (audioChannelsToUse.getUnchecked (i), 0);
         }
 
         AudioSampleBuffer buffer (channels, totalChans, numSamples);
-        
+        node->applyParameterUpdates();
+
         if (! node->isEnabled())
         {
             for (int ch = numAudioIns; ch < numAudioOuts; ++ch)
@@ -240,85 +329,80 @@ public:
             return;
         }
 
+        const int osState = node->osState.get();
+        if (osState == GraphNode::osSwitching)
+        {
+            // the oversampler is being replaced on the message thread
+            buffer.clear();
+            return;
+        }
+
         const bool muted = node->isMuted();
         const bool muteInput = node->isMutingInputs();
 
+        // levels are only measured while something displays them, and then
+        // only often enough to keep up with the display
+        bool meterThisBlock = false;
+        if (node->isMetering())
+        {
+            meterCountdown -= numSamples;
+            if (meterCountdown <= 0)
+            {
+                meterThisBlock = true;
+                meterCountdown = meterInterval;
+            }
+        }
+
         if (muted && muteInput)
         {
             if (lastMute != muted)
             {
                 // just became muted
-                buffer.applyGainRamp (0, numSamples, node->getLastInputGain(), 0.0);
+                applyGain (buffer, numSamples, node->getLastInputGain(), 0.0, meterThisBlock ? numAudioIns : 0);
             }
             else
             {
                 // normal mute processing
-                buffer.applyGain (0, numSamples, 0.0);
+                applyGain (buffer, numSamples, 0.0, 0.0, meterThisBlock ? numAudioIns : 0);
             }
         }
         else if (!muted && muteInput && muted != lastMute)
         {
             // just became unmuted
-            buffer.applyGainRamp (0, numSamples, 0.0, node->getInputGain());
+            applyGain (buffer, numSamples, 0.0, node->getInputGain(), meterThisBlock ? numAudioIns : 0);
         }
         else if (node->getInputGain() != node->getLastInputGain())
         {
-            buffer.applyGainRamp (0, numSamples, node->getLastInputGain(), node->getInputGain());
+            applyGain (buffer, numSamples, node->getLastInputGain(), node->getInputGain(), meterThisBlock ? numAudioIns : 0);
         } 
         else 
         {
-            buffer.applyGain (0, numSamples, node->getInputGain());
+            applyGain (buffer, numSamples, node->getInputGain(), node->getInputGain(), meterThisBlock ? numAudioIns : 0);
         }
 
-        for (int i = numAudioIns; --i >= 0;)
-            node->setInputRMS (i, buffer.getRMSLevel (i, 0, numSamples));
+        if (meterThisBlock)
+            for (int i = jmin (numAudioIns, totalChans); --i >= 0;)
+                node->setInputRMS (i, levels[i]);
 
        #ifndef EL_FREE
         // Begin MIDI filters
         {
-            jassert (tempMidi.getNumEvents() == 0);
-            ScopedLock spl (node->getPropertyLock());
-            transpose.setNoteOffset (node->getTransposeOffset());
-            const auto keyRange (node->getKeyRange());
-            const auto midiChans (node->getMidiChannels());
-            const auto useMidiProgram (node->areMidiProgramsEnabled());
- 
-            if (keyRange.getLength() > 0 || !midiChans.isOmni() || useMidiProgram)
+            filterTable.update (node->getMidiFilter());
+            if (! filterTable.isBypassed())
             {
-                auto& midi = *sharedMidiBuffers.getUnchecked (midiBufferToUse);
-                MidiBuffer::Iterator iter (midi);
-                int frame = 0; MidiMessage msg;
-                while (iter.getNextEvent (msg, frame))
-                {
-                    if (msg.isNoteOnOrOff())
-                    {
-                        // out of range 
-                        if (keyRange.getLength() > 0 && (msg.getNoteNumber() < keyRange.getStart() || msg.getNoteNumber() > keyRange.getEnd()))
-                            continue;
-                    }
-
-                    if (msg.getChannel() > 0 && midiChans.isOff (msg.getChannel()))
-                        continue;
+                int program = -1;
+                const int numDropped = filterTable.process (*sharedMidiBuffers.getUnchecked (midiBufferToUse),
+                                                            tempMidi, program);
+                if (numDropped > 0)
+                    droppedMidiEvents += numDropped;
 
-                    if (useMidiProgram && msg.isProgramChange())
-                    {
-                        node->setMidiProgram (msg.getProgramChangeNumber());
-                        node->reloadMidiProgram();
-                        continue;
-                    }
-
-                    transpose.process (msg);
-                    tempMidi.addEvent (msg, frame);
+                if (program >= 0)
+                {
+                    node->setMidiProgram (program);
+                    node->reloadMidiProgram();
                 }
-
-                midi.swapWith (tempMidi);
-            }
-            else
-            {
-                transpose.process (*sharedMidiBuffers.getUnchecked (midiBufferToUse), numSamples);
             }
         }
-        tempMidi.clear();
         // End MIDI filters
        #endif
         
@@ -344,19 +428,15 @@ public:
                 }
             };
 
-            if (node->getOversamplingFactor() > 1)
+            if (auto* const osProcessor = node->getOversamplingProcessor())
             {
-                auto osProcessor = node->getOversamplingProcessor();
-
                 dsp::AudioBlock<float> block (buffer);
                 dsp::AudioBlock<float> osBlock = osProcessor->processSamplesUp (block);
 
-                std::unique_ptr<float*> ptrArray;
-                ptrArray.reset (new float* [buffer.getNumChannels()]);
                 for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
-                    ptrArray.get()[ch] = osBlock.getChannelPointer (ch);
+                    osChannels[ch] = osBlock.getChannelPointer (ch);
 
-                AudioBuffer<float> osBuffer (ptrArray.get(), buffer.getNumChannels(), static_cast<int> (osBlock.getNumSamples()));
+                AudioBuffer<float> osBuffer (osChannels, buffer.getNumChannels(), static_cast<int> (osBlock.getNumSamples()));
                 pluginProcessBlock (osBuffer, processor->isSuspended());
 
                 osProcessor->processSamplesDown (block);
@@ -367,39 +447,67 @@ public:
             }
             
         }
+
+        if (osState == GraphNode::osFadingOut)
+        {
+            buffer.applyGainRamp (0, numSamples, 1.0f, 0.0f);
+            node->osState.compareAndSetBool (GraphNode::osSwitching, GraphNode::osFadingOut);
+        }
+        else if (osState == GraphNode::osFadingIn)
+        {
+            buffer.applyGainRamp (0, numSamples, 0.0f, 1.0f);
+            node->osState.compareAndSetBool (GraphNode::osActive, GraphNode::osFadingIn);
+        }
         
         if (muted && !muteInput)
         {
             if (lastMute != muted)
             {
                 // just became muted
-                buffer.applyGainRamp (0, numSamples, node->getLastGain(), 0.0);
+                applyGain (buffer, numSamples, node->getLastGain(), 0.0, meterThisBlock ? numAudioOuts : 0);
             }
             else
             {
                 // normal mute processing
-                buffer.applyGain (0, numSamples, 0.0);
+                applyGain (buffer, numSamples, 0.0, 0.0, meterThisBlock ? numAudioOuts : 0);
             }
         }
         else if (!muted && !muteInput && muted != lastMute)
         {
             // just became unmuted
-            buffer.applyGainRamp (0, numSamples, 0.0, node->getGain());
+            applyGain (buffer, numSamples, 0.0, node->getGain(), meterThisBlock ? numAudioOuts : 0);
         }
         else if (node->getGain() != node->getLastGain())
         {
-            buffer.applyGainRamp (0, numSamples, node->getLastGain(), node->getGain());
+            applyGain (buffer, numSamples, node->getLastGain(), node->getGain(), meterThisBlock ? numAudioOuts : 0);
         }
         else 
         {
-            buffer.applyGain (0, numSamples, node->getGain());
+            applyGain (buffer, numSamples, node->getGain(), node->getGain(), meterThisBlock ? numAudioOuts : 0);
         }
 
         node->updateGain();
         lastMute = muted;
 
-        for (int i = 0; i < numAudioOuts; ++i)
-            node->setOutputRMS (i, buffer.getRMSLevel (i, 0, numSamples));
+        if (meterThisBlock)
+            for (int i = 0; i < jmin (numAudioOuts, totalChans); ++i)
+                node->setOutputRMS (i, levels[i]);
+    }
+
+    bool isNodeTask() const { return true; }
+
+    void getBufferUsage (BufferUsage& usage) const
+    {
+        // nodes process in place, so everything they touch is read and written
+        for (int i = 0; i < totalChans; ++i)
+            usage.readWrite (BufferUsage::audio (audioChannelsToUse.getUnchecked (i)));
+        for (const auto index : midiChannelsToUse)
+            usage.readWrite (BufferUsage::midi (index));
+        usage.readWrite (BufferUsage::midi (midiBufferToUse));
+
+        // IO nodes read and write the parent graph's buffers
+        if (node->isAudioIONode() || node->isMidiIONode())
+            usage.readWrite (BufferUsage::graphIO);
     }
 
     const GraphNodePtr node;
@@ -408,11 +516,64 @@ public:
 private:
     Array <int> audioChannelsToUse;
     Array <int> midiChannelsToUse;
-    HeapBlock <float*> channels;
+    HeapBlock <float*> channels, osChannels;
+    HeapBlock <float> levels;
     int totalChans, numAudioIns, numAudioOuts;
     int midiBufferToUse;
+    Atomic<int>& droppedMidiEvents;
+    int meterInterval = 0, meterCountdown = 0;
     bool lastMute = false;
-    MidiTranspose transpose;
+
+    /** Applies a gain ramp to every channel. The RMS level of the first
+        'numToMeter' channels after the gain is measured in the same pass and
+        stored in 'levels'. */
+    void applyGain (AudioSampleBuffer& buffer, const int numSamples,
+                    const float startGain, const float endGain, int numToMeter)
+    {
+        numToMeter = jmin (numToMeter, buffer.getNumChannels());
+        for (int ch = 0; ch < numToMeter; ++ch)
+            levels[ch] = applyGainAndGetRMS (buffer.getWritePointer (ch), numSamples, startGain, endGain);
+
+        for (int ch = numToMeter; ch < buffer.getNumChannels(); ++ch)
+        {
+            if (startGain == endGain)
+                buffer.applyGain (ch, 0, numSamples, startGain);
+            else
+                buffer.applyGainRamp (ch, 0, numSamples, startGain, endGain);
+        }
+    }
+
+    static float applyGainAndGetRMS (float* const data, const int numSamples,
+                                     const float startGain, const float endGain) noexcept
+    {
+        if (numSamples <= 0)
+            return 0.f;
+
+        // separate accumulators so the loop can be vectorized
+        const float increment = (endGain - startGain) / (float) numSamples;
+        float sums[4] = { 0.f, 0.f, 0.f, 0.f };
+        int i = 0;
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            for (int j = 0; j < 4; ++j)
+            {
+                const float sample = data[i + j] * (startGain + increment * (float) (i + j));
+                data[i + j] = sample;
+                sums[j] += sample * sample;
+            }
+        }
+
+        for (; i < numSamples; ++i)
+        {
+            const float sample = data[i] * (startGain + increment * (float) i);
+            data[i] = sample;
+            sums[0] += sample * sample;
+        }
+
+        return std::sqrt ((sums[0] + sums[1] + sums[2] + sums[3]) / (float) numSamples);
+    }
+    MidiFilterTable filterTable;
     MidiBuffer tempMidi;
     JUCE_DECLARE_NON_COPYABLE (ProcessBufferOp)
 };
@@ -430,6 +591,9 @@ public:
           orderedNodes (orderedNodes_),
           totalLatency (0)
     {
+        for (int i = 0; i < orderedNodes.size(); ++i)
+            orderIndexes.set ((int) ((GraphNode*) orderedNodes.getUnchecked (i))->nodeId, i);
+
         for (int i = 0; i < PortType::Unknown; ++i)
         {
             allNodes[i].add ((uint32) zeroNodeID);  // first buffer is read-only zeros
@@ -443,10 +607,10 @@ public:
             markUnusedBuffersFree (i);
         }
 
-        graph.setLatencySamples (totalLatency);
     }
 
     int32 buffersNeeded (PortType type)     { return allNodes[type.id()].size(); }
+    int getTotalLatencySamples() const      { return totalLatency; }
 
 private:
     //==============================================================================
@@ -459,37 +623,23 @@ private:
 
     static bool isNodeBusy (uint32 nodeID) noexcept { return nodeID != freeNodeID && nodeID != zeroNodeID; }
 
-    Array <uint32> nodeDelayIDs;
-    Array <int> nodeDelays;
+    HashMap<int, int> nodeDelays;
+    HashMap<int, int> orderIndexes;
     int totalLatency;
 
-    int getNodeDelay (const uint32 nodeID) const          { return nodeDelays [nodeDelayIDs.indexOf (nodeID)]; }
+    int getNodeDelay (const uint32 nodeID) const          { return nodeDelays [(int) nodeID]; }
 
     void setNodeDelay (const uint32 nodeID, const int latency)
     {
-        const int index = nodeDelayIDs.indexOf (nodeID);
-
-        if (index >= 0)
-        {
-            nodeDelays.set (index, latency);
-        }
-        else
-        {
-            nodeDelayIDs.add (nodeID);
-            nodeDelays.add (latency);
-        }
+        nodeDelays.set ((int) nodeID, latency);
     }
 
     int getInputLatency (const uint32 nodeID) const
     {
         int maxLatency = 0;
 
-        for (int i = graph.getNumConnections(); --i >= 0;)
-        {
-            const auto* const c = graph.getConnection (i);
-            if (c->destNode == nodeID)
-                maxLatency = jmax (maxLatency, getNodeDelay (c->sourceNode));
-        }
+        for (const auto* const c : graph.getInputConnections (nodeID))
+            maxLatency = jmax (maxLatency, getNodeDelay (c->sourceNode));
 
         return maxLatency;
     }
@@ -551,11 +701,12 @@ private:
             // get a list of all the inputs to this node
             Array <uint32> sourceNodes;
             Array <uint32> sourcePorts;
-            for (int i = graph.getNumConnections(); --i >= 0;)
+            const auto& inputs = graph.getInputConnections (node->nodeId);
+            for (int i = inputs.size(); --i >= 0;)
             {
-                const GraphProcessor::Connection* const c = graph.getConnection (i);
+                const GraphProcessor::Connection* const c = inputs.getUnchecked (i);
 
-                if (c->destNode == node->nodeId && c->destPort == port)
+                if (c->destPort == port)
                 {
                     sourceNodes.add (c->sourceNode);
                     sourcePorts.add (c->sourcePort);
@@ -615,7 +766,7 @@ private:
                             renderingOps.add (new CopyChannelOp (bufIndex, newFreeBuffer));
                             break;
                         case PortType::Midi:
-                            renderingOps.add (new CopyMidiBufferOp (bufIndex, newFreeBuffer));
+                            renderingOps.add (new CopyMidiBufferOp (bufIndex, newFreeBuffer, graph.numDroppedMidiEvents));
                             break;
                         default:
                             break;
@@ -684,7 +835,7 @@ private:
                         if (portType == PortType::Audio)
                             renderingOps.add (new CopyChannelOp (srcIndex, bufIndex));
                         else if (portType == PortType::Midi)
-                            renderingOps.add (new CopyMidiBufferOp (srcIndex, bufIndex));
+                            renderingOps.add (new CopyMidiBufferOp (srcIndex, bufIndex, graph.numDroppedMidiEvents));
                     }
 
                     reusableInputIndex = 0;
@@ -730,7 +881,7 @@ private:
                             }
                             else if (portType == PortType::Midi)
                             {
-                                renderingOps.add (new AddMidiBufferOp (srcIndex, bufIndex));
+                                renderingOps.add (new AddMidiBufferOp (srcIndex, bufIndex, graph.numDroppedMidiEvents));
                             }
                         }
                     }
@@ -755,7 +906,8 @@ private:
         int totalChans = jmax (node->getNumPorts (PortType::Audio, true),
                                node->getNumPorts (PortType::Audio, false));
         renderingOps.add (new ProcessBufferOp (node, channelsToUse [PortType::Audio],
-                                               totalChans, 0, channelsToUse));
+                                               totalChans, 0, channelsToUse,
+                                               graph.numDroppedMidiEvents));
     }
 
     int getFreeBuffer (PortType type)
@@ -812,23 +964,22 @@ private:
     bool isBufferNeededLater (int stepIndexToSearchFrom, uint32 inputChannelOfIndexToIgnore,
                               const uint32 sourceNode, const uint32 outputPortIndex) const
     {
-        while (stepIndexToSearchFrom < orderedNodes.size())
+        // only the outputs of the source need checking, not every node after this step
+        for (const auto* const c : graph.getOutputConnections (sourceNode))
         {
-            const GraphNode* const node = (const GraphNode*) orderedNodes.getUnchecked (stepIndexToSearchFrom);
+            if (c->sourcePort != outputPortIndex || ! orderIndexes.contains ((int) c->destNode))
+                continue;
 
-            {
-                for (uint32 port = 0; port < node->getNumPorts(); ++port)
-                {
-                    if (port != inputChannelOfIndexToIgnore &&
-                          graph.getConnectionBetween (sourceNode, outputPortIndex, node->nodeId, port) != nullptr)
-                    {
-                        return true;
-                    }
-                }
-            }
+            const int step = orderIndexes [(int) c->destNode];
+            if (step < stepIndexToSearchFrom)
+                continue;
 
-            inputChannelOfIndexToIgnore = KV_INVALID_PORT;
-            ++stepIndexToSearchFrom;
+            const GraphNode* const node = (const GraphNode*) orderedNodes.getUnchecked (step);
+            if (c->destPort >= node->getNumPorts())
+                continue;
+
+            if (step > stepIndexToSearchFrom || c->destPort != inputChannelOfIndexToIgnore)
+                return true;
         }
 
         return false;
@@ -847,8 +998,173 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProcessorGraphBuilder)
 };
 
+/** Splits a rendering sequence into stages, one per node, and works out
+    which stages depend on each other from the shared buffers they touch.
+
+    A stage waits for the last stage to write any buffer it uses, and a stage
+    which writes a buffer also waits for everything reading it since.  This
+    keeps the output identical to serial rendering even though buffers are
+    re-used by the ProcessorGraphBuilder. */
+class ParallelSequence : public RenderSchedule::Performer
+{
+public:
+    ParallelSequence (const Array<void*>& ops)
+    {
+        HashMap<int, int> lastWriters;
+        HashMap<int, Array<int>> readers;
+        BufferUsage usage;
+        int firstOp = 0;
+
+        for (int i = 0; i < ops.size(); ++i)
+        {
+            auto* const task = static_cast<Task*> (ops.getUnchecked (i));
+            tasks.add (task);
+            task->getBufferUsage (usage);
+            if (! task->isNodeTask() && i < ops.size() - 1)
+                continue;
+
+            const int stage = schedule.addStage();
+            stages.add (Range<int> (firstOp, i + 1));
+            firstOp = i + 1;
+
+            for (const auto resource : usage.reads)
+                if (lastWriters.contains (resource))
+                    schedule.addDependency (lastWriters [resource], stage);
+
+            for (const auto resource : usage.writes)
+            {
+                if (lastWriters.contains (resource))
+                    schedule.addDependency (lastWriters [resource], stage);
+                if (readers.contains (resource))
+                    for (const auto reader : readers.getReference (resource))
+                        schedule.addDependency (reader, stage);
+            }
+
+            for (const auto resource : usage.reads)
+                if (! usage.writes.contains (resource))
+                    readers.getReference (resource).addIfNotAlreadyThere (stage);
+
+            for (const auto resource : usage.writes)
+            {
+                lastWriters.set (resource, stage);
+                readers.getReference (resource).clearQuick();
+            }
+
+            usage = BufferUsage();
+        }
+
+        schedule.finalize();
+    }
+
+    bool canRenderInParallel() const noexcept { return schedule.canRenderInParallel(); }
+
+    void render (RenderThreadPool& pool, AudioSampleBuffer& audio,
+                 const OwnedArray<MidiBuffer>& midi, const int numSamples)
+    {
+        sharedAudio     = &audio;
+        sharedMidi      = &midi;
+        blockSize       = numSamples;
+        pool.perform (schedule, *this);
+    }
+
+    void performStage (int stage) override
+    {
+        const auto range = stages.getUnchecked (stage);
+        for (int i = range.getStart(); i < range.getEnd(); ++i)
+            tasks.getUnchecked (i)->perform (*sharedAudio, *sharedMidi, blockSize);
+    }
+
+private:
+    Array<Task*> tasks;
+    RenderSchedule schedule;
+    Array<Range<int>> stages;
+
+    AudioSampleBuffer* sharedAudio = nullptr;
+    const OwnedArray<MidiBuffer>* sharedMidi = nullptr;
+    int blockSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (ParallelSequence)
+};
+
+/** Everything the audio thread needs to render a graph: the ops, the shared
+    buffers they render into and the latency of the sequence.  A program is
+    fully allocated before it is published and never changes afterwards. */
+class RenderProgram
+{
+public:
+    RenderProgram (Array<void*>& opsToUse, int numAudioBuffers, int numMidiBuffers,
+                   int latency, int maxBlockSize)
+        : audioBuffers (jmax (1, numAudioBuffers), jmax (1, maxBlockSize)),
+          latencySamples (latency)
+    {
+        ops.swapWith (opsToUse);
+        audioBuffers.clear();
+
+        const size_t midiBufferSize = (size_t) MidiPipe::getBufferSizeForBlockSize (maxBlockSize);
+        for (int i = 0; i < numMidiBuffers; ++i)
+            midiBuffers.add (new MidiBuffer())->ensureSize (midiBufferSize);
+
+        parallel.reset (new ParallelSequence (ops));
+    }
+
+    ~RenderProgram()
+    {
+        parallel.reset();
+        for (int i = ops.size(); --i >= 0;)
+            delete static_cast<Task*> (ops.getUnchecked (i));
+    }
+
+    int getLatencySamples() const noexcept { return latencySamples; }
+
+    /** The most samples that can be rendered at once */
+    int getBlockSize() const noexcept { return audioBuffers.getNumSamples(); }
+
+    void render (RenderThreadPool* pool, const int numSamples)
+    {
+        jassert (numSamples <= getBlockSize());
+        if (pool != nullptr && ! pool->isPerforming() && parallel->canRenderInParallel())
+        {
+            parallel->render (*pool, audioBuffers, midiBuffers, numSamples);
+            return;
+        }
+
+        for (int i = 0; i < ops.size(); ++i)
+            static_cast<Task*> (ops.getUnchecked (i))->perform (audioBuffers, midiBuffers, numSamples);
+    }
+
+    /** Link used by the graph's stack of retired programs */
+    RenderProgram* nextRetired = nullptr;
+
+private:
+    Array<void*> ops;
+    std::unique_ptr<ParallelSequence> parallel;
+    AudioSampleBuffer audioBuffers;
+    OwnedArray<MidiBuffer> midiBuffers;
+    const int latencySamples;
+
+    JUCE_DECLARE_NON_COPYABLE (RenderProgram)
+};
+
 }
 
+/** Frees programs the audio thread has finished with */
+class GraphProcessor::ProgramReclaimer : public Timer
+{
+public:
+    ProgramReclaimer (GraphProcessor& g) : graph (g) { }
+
+    void timerCallback() override
+    {
+        graph.reclaimRenderPrograms();
+        graph.releaseRetiredNodes();
+        if (graph.pendingProgram.load() == nullptr && graph.retiredNodes.isEmpty())
+            stopTimer();
+    }
+
+private:
+    GraphProcessor& graph;
+};
+
 GraphProcessor::Connection::Connection (const uint32 sourceNode_, const uint32 sourcePort_,
                                         const uint32 destNode_, const uint32 destPort_) noexcept
     : Arc (sourceNode_, sourcePort_, destNode_, destPort_)
@@ -862,20 +1178,27 @@ GraphProcessor::Connection::Connection (const uint32 sourceNode_, const uint32 s
     
 GraphProcessor::GraphProcessor()
     : lastNodeId (0),
-      renderingBuffers (1, 1),
       currentAudioInputBuffer (nullptr),
       currentAudioOutputBuffer (1, 1),
       currentMidiInputBuffer (nullptr)
 {
     for (int i = 0; i < AudioGraphIOProcessor::numDeviceTypes; ++i)
         ioNodes[i] = KV_INVALID_PORT;
+    reclaimer.reset (new ProgramReclaimer (*this));
 }
 
 GraphProcessor::~GraphProcessor()
 {
     renderingSequenceChanged.disconnect_all_slots();
-    clearRenderingSequence();
     clear();
+
+    // the audio thread can't be using this graph anymore
+    reclaimer = nullptr;
+    adoptPendingProgram();
+    reclaimRenderPrograms();
+    delete activeProgram;
+    activeProgram = nullptr;
+    releaseRetiredNodes (true);
 }
 
 const String GraphProcessor::getName() const
@@ -885,8 +1208,14 @@ const String GraphProcessor::getName() const
 
 void GraphProcessor::clear()
 {
+    for (auto* node : nodes)
+        retireNode (node);
     nodes.clear();
     connections.clear();
+    nodeInputs.clear();
+    nodeOutputs.clear();
+    nodeOrder.clearQuick();
+    nodeOrderValid = true;
     //triggerAsyncUpdate();
     handleAsyncUpdate();
 }
@@ -944,8 +1273,10 @@ GraphNode* GraphProcessor::addNode (AudioProcessor* const newProcessor, uint32 n
     {
         node->setParentGraph (this);
         node->resetPorts();
-        node->prepare (getSampleRate(), getBlockSize(), this);
+        node->prepare (getSampleRate(), getRenderBlockSize(), this);
         nodes.add (node);
+        if (nodeOrderValid)
+            nodeOrder.add (node);
         triggerAsyncUpdate();
         return node;
     }
@@ -995,8 +1326,10 @@ GraphNode* GraphProcessor::addNode (GraphNode* newNode, uint32 nodeId)
     
     newNode->setParentGraph (this);
     newNode->resetPorts();
-    newNode->prepare (getSampleRate(), getBlockSize(), this);
+    newNode->prepare (getSampleRate(), getRenderBlockSize(), this);
     triggerAsyncUpdate();
+    if (nodeOrderValid)
+        nodeOrder.add (newNode);
     return nodes.add (newNode);
 }
 
@@ -1009,12 +1342,15 @@ bool GraphProcessor::removeNode (const uint32 nodeId)
         GraphNodePtr n = nodes.getUnchecked (i);
         if (nodes.getUnchecked(i)->nodeId == nodeId)
         {
+            nodeOrder.removeFirstMatchingValue (n.get());
+            nodeInputs.remove ((int) nodeId);
+            nodeOutputs.remove ((int) nodeId);
             nodes.remove (i);
+            retireNode (n.get());
          
             // triggerAsyncUpdate();
             // do this syncronoously so it wont try processing with a null graph
             handleAsyncUpdate();
-            n->setParentGraph (nullptr);
 
             if (auto* sub = dynamic_cast<SubGraphProcessor*> (n->getAudioProcessor()))
             {
@@ -1110,6 +1446,7 @@ bool GraphProcessor::addConnection (const uint32 sourceNode, const uint32 source
     ArcSorter sorter;
     Connection* c = new Connection (sourceNode, sourcePort, destNode, destPort);
     connections.addSorted (sorter, c);
+    addToConnectionIndex (c);
     triggerAsyncUpdate();
     return true;
 }
@@ -1127,10 +1464,91 @@ bool GraphProcessor::connectChannels (PortType type, uint32 sourceNode, int32 so
 
 void GraphProcessor::removeConnection (const int index)
 {
+    if (auto* c = connections [index])
+        removeFromConnectionIndex (c);
     connections.remove (index);
     triggerAsyncUpdate();
 }
 
+void GraphProcessor::addToConnectionIndex (Connection* c)
+{
+    ArcSorter sorter;
+    nodeInputs.getReference ((int) c->destNode).addSorted (sorter, c);
+    nodeOutputs.getReference ((int) c->sourceNode).addSorted (sorter, c);
+
+    // removing arcs never breaks the order, adding one only does if it points backwards
+    if (nodeOrderValid)
+    {
+        int sourceIndex = -1, destIndex = -1;
+        for (int i = nodeOrder.size(); --i >= 0 && (sourceIndex < 0 || destIndex < 0);)
+        {
+            const auto nodeId = nodeOrder.getUnchecked(i)->nodeId;
+            if (nodeId == c->sourceNode) sourceIndex = i;
+            if (nodeId == c->destNode)   destIndex = i;
+        }
+
+        if (sourceIndex > destIndex)
+            nodeOrderValid = false;
+    }
+}
+
+void GraphProcessor::removeFromConnectionIndex (const Connection* c)
+{
+    nodeInputs.getReference ((int) c->destNode).removeFirstMatchingValue (const_cast<Connection*> (c));
+    nodeOutputs.getReference ((int) c->sourceNode).removeFirstMatchingValue (const_cast<Connection*> (c));
+}
+
+const Array<GraphProcessor::Connection*>& GraphProcessor::getInputConnections (const uint32 nodeId)
+{
+    return nodeInputs.getReference ((int) nodeId);
+}
+
+const Array<GraphProcessor::Connection*>& GraphProcessor::getOutputConnections (const uint32 nodeId)
+{
+    return nodeOutputs.getReference ((int) nodeId);
+}
+
+const Array<GraphNode*>& GraphProcessor::getNodeOrder()
+{
+    if (nodeOrderValid)
+        return nodeOrder;
+
+    // Kahn's algorithm. Ties are broken by the order nodes were added so
+    // the result is stable between rebuilds.
+    HashMap<int, int> numInputs;
+    for (const auto* c : connections)
+        if (c->sourceNode != c->destNode)
+            numInputs.set ((int) c->destNode, numInputs [(int) c->destNode] + 1);
+
+    nodeOrder.clearQuick();
+    for (auto* node : nodes)
+        if (numInputs [(int) node->nodeId] == 0)
+            nodeOrder.add (node);
+
+    for (int i = 0; i < nodeOrder.size(); ++i)
+    {
+        for (const auto* c : getOutputConnections (nodeOrder.getUnchecked(i)->nodeId))
+        {
+            if (c->sourceNode == c->destNode)
+                continue;
+            const int remaining = numInputs [(int) c->destNode] - 1;
+            numInputs.set ((int) c->destNode, remaining);
+            if (remaining == 0)
+                if (auto* dest = getNodeForId (c->destNode))
+                    nodeOrder.add (dest);
+        }
+    }
+
+    // anything left over is part of a feedback loop
+    if (nodeOrder.size() < nodes.size())
+        for (auto* node : nodes)
+            if (numInputs [(int) node->nodeId] > 0)
+                nodeOrder.addIfNotAlreadyThere (node);
+
+    nodeOrderValid = true;
+    return nodeOrder;
+}
+
 bool GraphProcessor::removeConnection (const uint32 sourceNode, const uint32 sourcePort,
                                        const uint32 destNode, const uint32 destPort)
 {
@@ -1234,23 +1652,107 @@ void GraphProcessor::setVelocityCurveMode (const VelocityCurve::Mode mode) noexc
     velocityCurve.setMode (mode);
 }
 
-static void deleteRenderOpArray (Array<void*>& ops)
+void GraphProcessor::setMidiCoalescing (const bool shouldCoalesce) noexcept
 {
-    for (int i = ops.size(); --i >= 0;)
-        delete static_cast<GraphRender::Task*> (ops.getUnchecked (i));
-    ops.clearQuick();
+    midiCoalescing.set (shouldCoalesce ? 1 : 0);
 }
 
 void GraphProcessor::clearRenderingSequence()
 {
-    Array<void*> oldOps;
+    Array<void*> noOps;
+    publishRenderProgram (new GraphRender::RenderProgram (noOps, 1, 0, 0, getRenderBlockSize()));
+}
+
+void GraphProcessor::publishRenderProgram (GraphRender::RenderProgram* program)
+{
+    // a program still pending was never seen by the audio thread
+    if (auto* stale = pendingProgram.exchange (program, std::memory_order_acq_rel))
+        delete stale;
+
+    setLatencySamples (program->getLatencySamples());
+    reclaimRenderPrograms();
+    if (reclaimer != nullptr && ! reclaimer->isTimerRunning())
+        reclaimer->startTimer (250);
+}
+
+void GraphProcessor::adoptPendingProgram() noexcept
+{
+    auto* const next = pendingProgram.exchange (nullptr, std::memory_order_acq_rel);
+    if (next == nullptr)
+        return;
+
+    if (auto* const old = activeProgram)
+    {
+        old->nextRetired = retiredPrograms.load (std::memory_order_relaxed);
+        while (! retiredPrograms.compare_exchange_weak (old->nextRetired, old,
+                                                        std::memory_order_release,
+                                                        std::memory_order_relaxed)) { }
+    }
 
+    activeProgram = next;
+}
+
+void GraphProcessor::reclaimRenderPrograms()
+{
+    auto* program = retiredPrograms.exchange (nullptr, std::memory_order_acquire);
+    while (program != nullptr)
     {
-        const ScopedLock sl (getCallbackLock());
-        renderingOps.swapWith (oldOps);
+        auto* const next = program->nextRetired;
+        delete program;
+        program = next;
     }
+}
+
+void GraphProcessor::retireNode (GraphNode* node)
+{
+    // the active program may still render it until the next one is adopted
+    retiredNodes.addIfNotAlreadyThere (node);
+}
+
+void GraphProcessor::releaseRetiredNodes (const bool force)
+{
+    // nothing pending means the audio thread moved on to a program
+    // built after the nodes were removed
+    if (retiredNodes.isEmpty() || (! force && pendingProgram.load (std::memory_order_acquire) != nullptr))
+        return;
 
-    deleteRenderOpArray (oldOps);
+    for (auto* node : retiredNodes)
+        if (! nodes.contains (node))
+            node->setParentGraph (nullptr);
+    retiredNodes.clear();
+}
+
+void GraphProcessor::setRenderThreadPool (RenderThreadPool* pool)
+{
+    const ScopedLock sl (getCallbackLock());
+    renderPool = pool;
+}
+
+void GraphProcessor::setMaximumBlockSize (const int newMaxBlockSize) noexcept
+{
+    maxBlockSize = jmax (0, newMaxBlockSize);
+}
+
+void GraphProcessor::setSubBlockSplitting (const bool shouldSplit, const int minSubBlockSize) noexcept
+{
+    subBlockSize.set (shouldSplit ? jmax (1, minSubBlockSize) : 0);
+}
+
+/** Returns the number of samples to render from 'start' so the next sub-block
+    begins on a MIDI event, or maxLength if no event needs a split. */
+static int getSubBlockLength (const MidiBuffer& midi, const int start,
+                              const int maxLength, const int minLength)
+{
+    if (maxLength <= minLength)
+        return maxLength;
+
+    MidiBuffer::Iterator iter (midi);
+    iter.setNextSamplePosition (start + minLength);
+    const uint8* data = nullptr; int size = 0, frame = 0;
+    if (iter.getNextEvent (data, size, frame) && frame < start + maxLength)
+        return frame - start;
+
+    return maxLength;
 }
 
 bool GraphProcessor::isAnInputTo (const uint32 possibleInputId,
@@ -1278,6 +1780,7 @@ void GraphProcessor::buildRenderingSequence()
     Array<void*> newRenderingOps;
     int numRenderingBuffersNeeded = 2;
     int numMidiBuffersNeeded = 1;
+    int latencySamples = 0;
 
     {
         //XXX:
@@ -1285,65 +1788,30 @@ void GraphProcessor::buildRenderingSequence()
 
         Array<void*> orderedNodes;
 
+        for (auto* const node : getNodeOrder())
         {
-            const LookupTable table (connections);
-
-            for (int i = 0; i < nodes.size(); ++i)
-            {
-                GraphNode* const node = nodes.getUnchecked(i);
-                node->prepare (getSampleRate(), getBlockSize(), this);
-
-                int j = 0;
-                for (; j < orderedNodes.size(); ++j)
-                    if (table.isAnInputTo (node->nodeId, ((GraphNode*) orderedNodes.getUnchecked(j))->nodeId))
-                      break;
-
-                orderedNodes.insert (j, node);
-            }
+            node->prepare (getSampleRate(), getRenderBlockSize(), this);
+            orderedNodes.add (node);
         }
 
         GraphRender::ProcessorGraphBuilder calculator (*this, orderedNodes, newRenderingOps);
 
         numRenderingBuffersNeeded = calculator.buffersNeeded (PortType::Audio);
         numMidiBuffersNeeded      = calculator.buffersNeeded (PortType::Midi);
+        latencySamples            = calculator.getTotalLatencySamples();
     }
 
-    {
-        // swap over to the new rendering sequence..
-        const ScopedLock sl (getCallbackLock());
-
-        renderingBuffers.setSize (numRenderingBuffersNeeded, 4096);
-        renderingBuffers.clear();
-
-        for (int i = midiBuffers.size(); --i >= 0;)
-            midiBuffers.getUnchecked(i)->clear();
-
-        while (midiBuffers.size() < numMidiBuffersNeeded)
-            midiBuffers.add (new MidiBuffer());
-
-        renderingOps.swapWith (newRenderingOps);
-    }
-
-    // delete the old ones..
-    deleteRenderOpArray (newRenderingOps);
+    // the audio thread picks this up at the start of its next block
+    publishRenderProgram (new GraphRender::RenderProgram (newRenderingOps,
+        numRenderingBuffersNeeded, numMidiBuffersNeeded, latencySamples, getRenderBlockSize()));
 
     renderingSequenceChanged();
 }
 
 void GraphProcessor::getOrderedNodes (ReferenceCountedArray<GraphNode>& orderedNodes)
 {
-    const LookupTable table (connections);
-    for (int i = 0; i < nodes.size(); ++i)
-    {
-        GraphNode* const node = nodes.getUnchecked(i);
-        
-        int j = 0;
-        for (; j < orderedNodes.size(); ++j)
-            if (table.isAnInputTo (node->nodeId, ((GraphNode*) orderedNodes.getUnchecked(j))->nodeId))
-                break;
-        
-        orderedNodes.insert (j, node);
-    }
+    for (auto* const node : getNodeOrder())
+        orderedNodes.add (node);
 }
 
 void GraphProcessor::handleAsyncUpdate()
@@ -1353,20 +1821,24 @@ void GraphProcessor::handleAsyncUpdate()
 
 void GraphProcessor::prepareToPlay (double sampleRate, int estimatedSamplesPerBlock)
 {
-    currentAudioInputBuffer = nullptr;
-    currentAudioOutputBuffer.setSize (jmax (1, getTotalNumOutputChannels()), estimatedSamplesPerBlock);
-    currentMidiInputBuffer = nullptr;
-    currentMidiOutputBuffer.clear();
-    clearRenderingSequence();
-
     if (getSampleRate() != sampleRate || getBlockSize() != estimatedSamplesPerBlock)
     {
         setPlayConfigDetails (getTotalNumInputChannels(), getTotalNumOutputChannels(),
             sampleRate, estimatedSamplesPerBlock);
     }
 
+    currentAudioInputBuffer = nullptr;
+    currentAudioOutputBuffer.setSize (jmax (1, getTotalNumOutputChannels()), jmax (1, getRenderBlockSize()));
+    currentMidiInputBuffer = nullptr;
+    currentMidiOutputBuffer.clear();
+    const int midiBufferSize = MidiPipe::getBufferSizeForBlockSize (getRenderBlockSize());
+    currentMidiOutputBuffer.ensureSize ((size_t) midiBufferSize);
+    filteredMidi.ensureSize ((size_t) midiBufferSize);
+    coalescedMidi.ensureSize ((size_t) midiBufferSize);
+    coalescer.prepare (midiBufferSize / 7);  // the smallest event is 7 bytes
+
     for (int i = 0; i < nodes.size(); ++i)
-        nodes.getUnchecked(i)->prepare (sampleRate, estimatedSamplesPerBlock, this);
+        nodes.getUnchecked(i)->prepare (sampleRate, getRenderBlockSize(), this);
 
     buildRenderingSequence();
 }
@@ -1376,8 +1848,7 @@ void GraphProcessor::releaseResources()
     for (int i = 0; i < nodes.size(); ++i)
         nodes.getUnchecked(i)->unprepare();
 
-    renderingBuffers.setSize (1, 1);
-    midiBuffers.clear();
+    clearRenderingSequence();
 
     currentAudioInputBuffer = nullptr;
     currentAudioOutputBuffer.setSize (1, 1);
@@ -1399,34 +1870,45 @@ void GraphProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMe
 {
     const int32 numSamples = buffer.getNumSamples();
 
+    adoptPendingProgram();
+    const int blockSize = activeProgram != nullptr ? activeProgram->getBlockSize() : numSamples;
+
     currentAudioInputBuffer = &buffer;
-    currentAudioOutputBuffer.setSize (jmax (1, buffer.getNumChannels()), numSamples);
-    currentAudioOutputBuffer.clear();
+    currentAudioOutputBuffer.setSize (jmax (1, buffer.getNumChannels()), blockSize, false, false, true);
     
+    MidiBuffer* input = &midiMessages;
+    if (midiCoalescing.get() != 0 && coalescer.process (midiMessages, coalescedMidi) > 0)
+        input = &coalescedMidi;
+
     if (midiChannels.isOmni() && velocityCurve.getMode() == VelocityCurve::Linear)
     {
-        currentMidiInputBuffer = &midiMessages;
+        currentMidiInputBuffer = input;
     }
     else
     {
+        // channel messages are filtered and note-ons curved on the raw bytes
         filteredMidi.clear();
-        MidiBuffer::Iterator iter (midiMessages);
-        MidiMessage msg; int frame = 0, chan = 0;
+        MidiBuffer::Iterator iter (*input);
+        const uint8* data = nullptr;
+        int numBytes = 0, frame = 0;
         
-        while (iter.getNextEvent (msg, frame))
+        while (iter.getNextEvent (data, numBytes, frame))
         {
-            chan = msg.getChannel();
-            if (chan > 0 && midiChannels.isOff (chan))
+            const int status = numBytes > 0 ? (int) data[0] : 0;
+            if (status >= 0x80 && status < 0xf0 && midiChannels.isOff ((status & 0x0f) + 1))
                 continue;
 
-            if (msg.isNoteOn())
+           #ifndef EL_FREE
+            if ((status & 0xf0) == 0x90 && numBytes >= 3 && data[2] > 0)
             {
-               #ifndef EL_FREE
-                msg.setVelocity (velocityCurve.process (msg.getFloatVelocity()));
-               #endif
+                const float velocity = velocityCurve.process ((float) data[2] * (1.0f / 127.0f));
+                const uint8 noteOn[3] = { data[0], data[1], (uint8) jlimit (1, 127, roundToInt (velocity * 127.0f)) };
+                MidiPipe::addEvent (filteredMidi, noteOn, 3, frame);
+                continue;
             }
+           #endif
 
-            filteredMidi.addEvent (msg, frame);
+            MidiPipe::addEvent (filteredMidi, data, numBytes, frame);
         }
         
         currentMidiInputBuffer = &filteredMidi;
@@ -1434,15 +1916,29 @@ void GraphProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMe
     
     currentMidiOutputBuffer.clear();
 
-    for (int i = 0; i < renderingOps.size(); ++i)
+    // blocks larger than the rendering buffers, or split at event timestamps, are
+    // rendered in pieces. IO nodes read and write the host buffers at renderOffset
+    const int minSubBlockSize = subBlockSize.get();
+    for (renderOffset = 0; renderOffset < numSamples;)
     {
-        GraphRender::Task* const op = static_cast<GraphRender::Task*> (renderingOps.getUnchecked (i));
-        op->perform (renderingBuffers, midiBuffers, numSamples);
+        int numToRender = jmin (blockSize, numSamples - renderOffset);
+        if (minSubBlockSize > 0)
+            numToRender = getSubBlockLength (*currentMidiInputBuffer, renderOffset,
+                                             numToRender, minSubBlockSize);
+
+        currentAudioOutputBuffer.clear (0, numToRender);
+
+        if (activeProgram != nullptr)
+            activeProgram->render (renderPool, numToRender);
+
+        for (int i = 0; i < buffer.getNumChannels(); ++i)
+            buffer.copyFrom (i, renderOffset, currentAudioOutputBuffer, i, 0, numToRender);
+
+        renderOffset += numToRender;
     }
 
-    for (int i = 0; i < buffer.getNumChannels(); ++i)
-        buffer.copyFrom (i, 0, currentAudioOutputBuffer, i, 0, numSamples);
-    
+    renderOffset = 0;
+
     midiMessages.clear();
     midiMessages.addEvents (currentMidiOutputBuffer, 0, numSamples, 0);
 }
@@ -1576,22 +2072,26 @@ void GraphProcessor::AudioGraphIOProcessor::processBlock (AudioSampleBuffer& buf
             for (int i = jmin (graph->currentAudioInputBuffer->getNumChannels(),
                                buffer.getNumChannels()); --i >= 0;)
             {
-                buffer.copyFrom (i, 0, *graph->currentAudioInputBuffer, i, 0, buffer.getNumSamples());
+                buffer.copyFrom (i, 0, *graph->currentAudioInputBuffer, i,
+                                 graph->renderOffset, buffer.getNumSamples());
             }
 
             break;
         }
 
         case midiOutputNode:
-            graph->currentMidiOutputBuffer.clear();
-            graph->currentMidiOutputBuffer.addEvents (midiMessages, 0, buffer.getNumSamples(), 0);
+            graph->currentMidiOutputBuffer.clear (graph->renderOffset, buffer.getNumSamples());
+            graph->numDroppedMidiEvents += MidiPipe::addEvents (graph->currentMidiOutputBuffer, midiMessages,
+                                                                0, buffer.getNumSamples(), graph->renderOffset);
             midiMessages.clear();
             break;
 
         case midiInputNode:
             midiMessages.clear();
-            midiMessages.addEvents (*graph->currentMidiInputBuffer, 0, buffer.getNumSamples(), 0);
-            graph->currentMidiInputBuffer->clear();
+            graph->numDroppedMidiEvents += MidiPipe::addEvents (midiMessages, *graph->currentMidiInputBuffer,
+                                                                graph->renderOffset, buffer.getNumSamples(),
+                                                                -graph->renderOffset);
+            graph->currentMidiInputBuffer->clear (graph->renderOffset, buffer.getNumSamples());
             break;
 
         default:
@@ -21,11 +21,20 @@
 
 #include "ElementApp.h"
 #include "engine/GraphNode.h"
+#include "engine/MidiExpressionCoalescer.h"
 #include "engine/VelocityCurve.h"
 #include "Signals.h"
 
 namespace Element {
 
+namespace GraphRender {
+class ParallelSequence;
+class ProcessorGraphBuilder;
+class RenderProgram;
+}
+
+class RenderThreadPool;
+
 /**
     A type of AudioProcessor which plays back a graph of other AudioProcessors.
 
@@ -187,6 +196,50 @@ public:
     /** Set the MIDI curve of this graph */
     void setVelocityCurveMode (const VelocityCurve::Mode) noexcept;
 
+    /** Remove redundant pitch bend, pressure and controller updates from the
+        graph's MIDI input each block.  See MidiExpressionCoalescer */
+    void setMidiCoalescing (bool shouldCoalesce) noexcept;
+
+    /** Returns true if redundant MIDI expression updates are removed */
+    bool isMidiCoalescing() const noexcept { return midiCoalescing.get() != 0; }
+
+    /** Render independent branches of this graph on a pool of worker threads.
+        Output is identical to serial rendering.  Pass nullptr to render serially.
+        The pool must be removed before it is deleted.
+     */
+    void setRenderThreadPool (RenderThreadPool* pool);
+
+    /** Sets the largest number of samples rendered in one pass.  Render buffers,
+        MIDI reservations and nodes are sized for it, so offline renders can use
+        big blocks without splitting or reallocating.  Host blocks bigger than
+        this are still split into sub-blocks.  Pass 0 to use the block size given
+        to prepareToPlay().  Takes effect when the graph is prepared.
+     */
+    void setMaximumBlockSize (int maxBlockSize) noexcept;
+
+    /** Returns the maximum block size set with setMaximumBlockSize() */
+    int getMaximumBlockSize() const noexcept { return maxBlockSize; }
+
+    /** Returns the number of samples nodes are prepared for and rendered with */
+    int getRenderBlockSize() const noexcept { return maxBlockSize > 0 ? maxBlockSize : getBlockSize(); }
+
+    /** Split rendering at the timestamps of incoming MIDI events, so program
+        changes, mutes and other per-block node state take effect at the event's
+        sample offset instead of at the start of the block.  Sub-blocks are never
+        shorter than minSubBlockSize samples.
+     */
+    void setSubBlockSplitting (bool shouldSplit, int minSubBlockSize = 32) noexcept;
+
+    /** Returns true if blocks are split at MIDI event timestamps */
+    bool isSubBlockSplitting() const noexcept { return subBlockSize.get() > 0; }
+
+    /** Returns the shortest sub-block rendered when splitting is enabled */
+    int getMinimumSubBlockSize() const noexcept { return jmax (1, subBlockSize.get()); }
+
+    /** Returns the number of MIDI events dropped because a preallocated
+        render buffer was full */
+    int getNumDroppedMidiEvents() const noexcept { return numDroppedMidiEvents.get(); }
+
     /** A special number that represents the midi channel of a node.
 
         This is used as a channel index value if you want to refer to the midi input
@@ -341,12 +394,45 @@ private:
     uint32 ioNodes [AudioGraphIOProcessor::numDeviceTypes];
     
     uint32 lastNodeId;
-    AudioSampleBuffer renderingBuffers;
-    OwnedArray <MidiBuffer> midiBuffers;
-    Array<void*> renderingOps;
+    RenderThreadPool* renderPool = nullptr;
+    int maxBlockSize = 0;
+    int renderOffset = 0;
+    Atomic<int> subBlockSize { 0 };
+    Atomic<int> numDroppedMidiEvents { 0 };
+
+    // Rendering programs are built off the audio thread and handed over through
+    // pendingProgram. The audio thread owns activeProgram and pushes the one it
+    // replaces onto the retired stack, which is freed later by the reclaimer.
+    // Removed nodes stay attached to the graph until the reclaimer sees the
+    // audio thread has adopted a program which no longer renders them.
+    std::atomic<GraphRender::RenderProgram*> pendingProgram { nullptr };
+    std::atomic<GraphRender::RenderProgram*> retiredPrograms { nullptr };
+    GraphRender::RenderProgram* activeProgram = nullptr;
+    class ProgramReclaimer;
+    std::unique_ptr<ProgramReclaimer> reclaimer;
+    ReferenceCountedArray<GraphNode> retiredNodes;
+
+    void publishRenderProgram (GraphRender::RenderProgram*);
+    void adoptPendingProgram() noexcept;
+    void reclaimRenderPrograms();
+    void retireNode (GraphNode*);
+    void releaseRetiredNodes (bool force = false);
 
     friend class AudioGraphIOProcessor;
     friend class GraphPort;
+    friend class GraphRender::ProcessorGraphBuilder;
+
+    // connections indexed by node and a topological order of the nodes. These
+    // are patched as the graph is edited instead of being rebuilt every time
+    HashMap<int, Array<Connection*>> nodeInputs, nodeOutputs;
+    Array<GraphNode*> nodeOrder;
+    bool nodeOrderValid = true;
+
+    void addToConnectionIndex (Connection*);
+    void removeFromConnectionIndex (const Connection*);
+    const Array<Connection*>& getInputConnections (uint32 nodeId);
+    const Array<Connection*>& getOutputConnections (uint32 nodeId);
+    const Array<GraphNode*>& getNodeOrder();
 
     AudioSampleBuffer* currentAudioInputBuffer;
     AudioSampleBuffer currentAudioOutputBuffer;
@@ -356,6 +442,9 @@ private:
     kv::MidiChannels midiChannels;
     VelocityCurve velocityCurve;
     MidiBuffer filteredMidi;
+    Atomic<int> midiCoalescing { 0 };
+    MidiExpressionCoalescer coalescer;
+    MidiBuffer coalescedMidi;
     
     void handleAsyncUpdate() override;
     void clearRenderingSequence();
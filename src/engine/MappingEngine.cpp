@@ -25,6 +25,9 @@
 
 namespace Element {
 
+// rate at which changes made by controllers are synced to the model
+static const int modelSyncRateHz = 30;
+
 class ControllerMapHandler
 {
 public:
@@ -33,10 +36,33 @@ public:
 
     virtual bool wants (const MidiMessage& message) const =0;
     virtual void perform (const MidiMessage& message) =0;
+
+    /** The controller number this handles or -1 */
+    virtual int getControllerNumber() const { return -1; }
+
+    /** The note number this handles or -1 */
+    virtual int getNoteNumber() const { return -1; }
+
+    /** Syncs the model with changes flagged by perform(). Called on the
+        message thread no faster than modelSyncRateHz */
+    virtual void syncModel() { }
+
+    /** Calls syncModel() if changes are pending */
+    void syncModelIfNeeded()
+    {
+        if (modelChanged.compareAndSetBool (0, 1))
+            syncModel();
+    }
+
+protected:
+    /** Flags that the model needs syncing. Safe to call from any thread */
+    void markModelChanged() { modelChanged.set (1); }
+
+private:
+    Atomic<int> modelChanged { 0 };
 };
 
 struct MidiNoteControllerMap : public ControllerMapHandler,
-                               public AsyncUpdater,
                                private Value::Listener
 {
     MidiNoteControllerMap (const ControllerDevice::Control& ctl,
@@ -82,6 +108,8 @@ struct MidiNoteControllerMap : public ControllerMapHandler,
             (channel.get() == 0 || (channel.get() > 0 && message.getChannel() == channel.get()));
     }
 
+    int getNoteNumber() const override { return noteNumber; }
+
     bool wants (const MidiMessage& message) const override
     {
         bool wants = momentary.get() == 0
@@ -103,28 +131,34 @@ struct MidiNoteControllerMap : public ControllerMapHandler,
        
         if (parameter != nullptr)
         {
-            parameter->beginChangeGesture();
+            float value = 0.f;
             if (momentary.get() == 0)
             {
-                parameter->setValueNotifyingHost (parameter->getValue() < 0.5 ? 1.f : 0.f);
+                value = parameter->getValue() < 0.5 ? 1.f : 0.f;
             }
             else
             {
                 const bool onOrOff = isInverse ? message.isNoteOff() : message.isNoteOn();
-                parameter->setValueNotifyingHost (onOrOff ? 1.f : 0.f);
+                value = onOrOff ? 1.f : 0.f;
             }
 
-            parameter->endChangeGesture();
+            // coalesced by the node and applied before its next block
+            if (! node->queueParameterValue (parameterIndex, value))
+            {
+                parameter->beginChangeGesture();
+                parameter->setValueNotifyingHost (value);
+                parameter->endChangeGesture();
+            }
         }
         else if (parameterIndex == GraphNode::EnabledParameter ||
                  parameterIndex == GraphNode::BypassParameter ||
                  parameterIndex == GraphNode::MuteParameter)
         {
-            triggerAsyncUpdate();
+            markModelChanged();
         }
     }
 
-    void handleAsyncUpdate() override
+    void syncModel() override
     {
         MidiMessage event;
 
@@ -212,7 +246,6 @@ private:
 };
 
 struct MidiCCControllerMapHandler : public ControllerMapHandler,
-                                    public AsyncUpdater,
                                     private Value::Listener
 {
     MidiCCControllerMapHandler (const ControllerDevice::Control& ctl, 
@@ -262,6 +295,8 @@ struct MidiCCControllerMapHandler : public ControllerMapHandler,
         channelObject.removeListener (this);
     }
 
+    int getControllerNumber() const override { return controllerNumber; }
+
     bool wants (const MidiMessage& message) const override
     {
         return message.isController() && 
@@ -275,9 +310,14 @@ struct MidiCCControllerMapHandler : public ControllerMapHandler,
 
         if (nullptr != parameter)
         {
-            parameter->beginChangeGesture();
-            parameter->setValueNotifyingHost (static_cast<float> (ccValue) / 127.f);
-            parameter->endChangeGesture();
+            // coalesced by the node and applied before its next block
+            const float value = static_cast<float> (ccValue) / 127.f;
+            if (! node->queueParameterValue (parameterIndex, value))
+            {
+                parameter->beginChangeGesture();
+                parameter->setValueNotifyingHost (value);
+                parameter->endChangeGesture();
+            }
         }
         else if (parameterIndex == GraphNode::EnabledParameter ||
                  parameterIndex == GraphNode::BypassParameter ||
@@ -336,13 +376,13 @@ struct MidiCCControllerMapHandler : public ControllerMapHandler,
             }
 
             if (currentToggleState != desiredToggleState.get())
-                triggerAsyncUpdate();
+                markModelChanged();
         }
 
         lastControllerValue = ccValue;
     }
 
-    void handleAsyncUpdate() override
+    void syncModel() override
     {
         const auto mode = toggleMode.get();
         const int stateToCompare = mode != ControllerDevice::Equals 
@@ -428,24 +468,44 @@ public:
         close();
     }
 
-    void handleIncomingMidiMessage (MidiInput*, const MidiMessage& message)
+    void handleIncomingMidiMessage (MidiInput*, const MidiMessage& message) override
     {
-        if ((! message.isController() || !controllerNumbers [message.getControllerNumber()]) &&
-            (!message.isNoteOnOrOff() || !noteNumbers [message.getNoteNumber()]))
-            return;
+        const Array<ControllerMapHandler*>* targets = nullptr;
 
-        // DBG("[EL] handle mapped MIDI: " << message.getControllerNumber() 
-        //     << " : " << message.getControllerValue());
-        if (message.isNoteOn())
-            mapping.captureNextEvent (*this, notes[message.getNoteNumber()], message);
-        else if (message.isController())
-            mapping.captureNextEvent (*this, controls[message.getControllerNumber()], message);
+        if (message.isController())
+        {
+            const int number = message.getControllerNumber();
+            if (! controllerNumbers [number])
+                return;
+            mapping.captureNextEvent (*this, controls[number], message);
+            targets = &controllerHandlers [number];
+        }
+        else if (message.isNoteOnOrOff())
+        {
+            const int number = message.getNoteNumber();
+            if (! noteNumbers [number])
+                return;
+            if (message.isNoteOn())
+                mapping.captureNextEvent (*this, notes[number], message);
+            targets = &noteHandlers [number];
+        }
+        else
+        {
+            return;
+        }
 
-        for (auto* handler : handlers)
+        for (auto* handler : *targets)
             if (handler->wants (message))
                 handler->perform (message);
     }
 
+    /** Syncs handlers which have changed the model. Message thread only */
+    void syncModel()
+    {
+        for (auto* handler : handlers)
+            handler->syncModelIfNeeded();
+    }
+
     bool close()
     {
         const auto deviceName = controllerDevice.getInputDevice().toString();
@@ -457,6 +517,21 @@ public:
     {
         close();
 
+        // the callback is removed, safe to rebuild the dispatch tables
+        for (int i = 0; i < 128; ++i)
+        {
+            controllerHandlers[i].clearQuick();
+            noteHandlers[i].clearQuick();
+        }
+
+        for (auto* handler : handlers)
+        {
+            if (isPositiveAndBelow (handler->getControllerNumber(), 128))
+                controllerHandlers [handler->getControllerNumber()].add (handler);
+            else if (isPositiveAndBelow (handler->getNoteNumber(), 128))
+                noteHandlers [handler->getNoteNumber()].add (handler);
+        }
+
         for (int i = controllerDevice.getNumControls(); --i >= 0;)
         {
             const auto control (controllerDevice.getControl (i));
@@ -512,22 +587,25 @@ private:
     ControllerDevice controllerDevice;
     std::unique_ptr<MidiInput> midiInput;
     OwnedArray<ControllerMapHandler> handlers;
+    Array<ControllerMapHandler*> controllerHandlers [128], noteHandlers [128];
     BigInteger controllerNumbers, noteNumbers;
     HashMap<int, ControllerDevice::Control> controls, notes;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ControllerMapInput)
 };
 
-class MappingEngine::Inputs
+class MappingEngine::Inputs : private Timer
 {
 public:
     Inputs() { }
-    ~Inputs() { }
+    ~Inputs() { stopTimer(); }
 
     bool add (ControllerMapInput* input)
     {
         if (inputs.contains (input))
             return true;
         inputs.add (input);
+        if (! isTimerRunning())
+            startTimerHz (modelSyncRateHz);
         if (isRunning())
             input->start();
         return inputs.contains (input);
@@ -547,6 +625,7 @@ public:
     void clear()
     {
         stop();
+        stopTimer();
         for (auto* input : inputs)
             input->close();
         inputs.clear (true);
@@ -568,6 +647,7 @@ public:
         running = false;
         for (auto* input : inputs)
             input->stop();
+        timerCallback();
     }
 
     ControllerMapInput* findInput (const ControllerDevice& controller) const
@@ -596,6 +676,12 @@ public:
 private:
     OwnedArray<ControllerMapInput> inputs;
     bool running = false;
+
+    void timerCallback() override
+    {
+        for (auto* input : inputs)
+            input->syncModel();
+    }
 };
 
 MappingEngine::MappingEngine()
@@ -22,46 +22,173 @@
 namespace Element
 {
     
-void MidiClock::process (const MidiMessage& msg)
+// bandwidth of the phase-locked loop in Hz
+static const double clockLoopBandwidth = 1.0;
+
+// listeners get tempo and jitter updates at this rate while locked
+static const double clockReportRateHz = 4.0;
+
+void MidiClock::process (const MidiMessage& msg, int frame)
 {
     jassert (sampleRate > 0.0 && blockSize > 0);
-    jassert (msg.isMidiClock() || msg.isSongPositionPointer());
-    
-    if (midiClockTicks <= 0)
+
+    if (msg.isMidiClock())
     {
-        dll.reset (msg.getTimeStamp(), (double)blockSize / sampleRate, 1.0);
-        dll.setParams ((double)blockSize / sampleRate, 1.0);
+        tick (static_cast<double> (blockStart + frame));
     }
-    else
+    else if (msg.isMidiStart())
     {
-        dll.update (msg.getTimeStamp());
+        running = true;
+        nextTickPosition = 0;
     }
-    
-    if (midiClockTicks == syncPeriodTicks)
-        for (auto* listener : listeners)
-            listener->midiClockSignalAcquired();
-    
-    if (midiClockTicks >= syncPeriodTicks && msg.getTimeStamp() - timeOfLastUpdate >= 1.0)
+    else if (msg.isMidiContinue())
     {
-        lastKnownTimeDiff   = dll.timeDiff();
-        const double bpm    = 60.0 / (lastKnownTimeDiff * 24.0);
-        timeOfLastUpdate    = msg.getTimeStamp();
-        
-        if (bpm >= 20.0 && bpm <= 999.0)
-            for (auto* listener : listeners)
-                listener->midiClockTempoChanged (bpm);
+        running = true;
+    }
+    else if (msg.isMidiStop())
+    {
+        running = false;
+    }
+    else if (msg.isSongPositionPointer())
+    {
+        // song position is in sixteenth notes, six ticks each
+        nextTickPosition = static_cast<int64> (msg.getSongPositionPointerMidiBeat()) * 6;
+    }
+}
+
+void MidiClock::tick (const double time)
+{
+    if (numTicks > 1)
+    {
+        const double error = time - predictedTime;
+        if (std::abs (error) > samplesPerTick)
+        {
+            // too far off to be jitter, start over
+            numTicks = 0;
+            setLocked (false);
+        }
+        else
+        {
+            const double omega = 2.0 * double_Pi * clockLoopBandwidth * samplesPerTick / sampleRate;
+            tickTime = predictedTime + std::sqrt (2.0) * omega * error;
+            samplesPerTick += omega * omega * error;
+            predictedTime = tickTime + samplesPerTick;
+            jitterSquared += 0.05 * (error * error - jitterSquared);
+        }
+    }
+    else if (numTicks == 1)
+    {
+        samplesPerTick = time - tickTime;
+        predictedTime = time + samplesPerTick;
+        tickTime = time;
+        jitterSquared = 0.0;
+    }
+
+    if (numTicks == 0)
+    {
+        tickTime = time;
+        samplesPerTick = 0.0;
+    }
+
+    ++numTicks;
+    if (running)
+        lastTickPosition = nextTickPosition++;
+
+    if (! locked && numTicks >= syncPeriodTicks && samplesPerTick > 0.0)
+        setLocked (true);
+}
+
+void MidiClock::advance (const int numSamples)
+{
+    blockStart += numSamples;
+
+    if (numTicks > 0)
+    {
+        const double timeout = jmax (samplesPerTick * 4.0, sampleRate * 0.25);
+        if (static_cast<double> (blockStart) - tickTime > timeout)
+        {
+            numTicks = 0;
+            setLocked (false);
+        }
+    }
+
+    if (locked)
+    {
+        samplesUntilReport -= numSamples;
+        if (samplesUntilReport <= 0)
+        {
+            samplesUntilReport = roundToInt (sampleRate / clockReportRateHz);
+            tempoToReport.set (static_cast<float> (getTempo()));
+            jitterToReport.set (getJitter());
+            triggerAsyncUpdate();
+        }
     }
-    
-    ++midiClockTicks;
 }
 
 void MidiClock::reset (const double sr, const int bs)
 {
     sampleRate          = sr;
     blockSize           = bs;
-    timeOfLastUpdate    = 0.0;
-    lastKnownTimeDiff   = 0.0;
-    midiClockTicks      = 0;
+    blockStart          = 0;
+    numTicks            = 0;
+    tickTime            = 0.0;
+    predictedTime       = 0.0;
+    samplesPerTick      = 0.0;
+    jitterSquared       = 0.0;
+    nextTickPosition    = 0;
+    lastTickPosition    = -1;
+    running             = false;
+    locked              = false;
+    samplesUntilReport  = 0;
+}
+
+double MidiClock::getTempo() const noexcept
+{
+    return samplesPerTick > 0.0 ? (60.0 * sampleRate) / (samplesPerTick * 24.0) : 0.0;
+}
+
+double MidiClock::getSongPosition (const int frame) const noexcept
+{
+    if (! running || numTicks <= 0 || samplesPerTick <= 0.0)
+        return static_cast<double> (nextTickPosition) / 24.0;
+
+    const double sinceTick = static_cast<double> (blockStart + frame) - tickTime;
+    return (static_cast<double> (lastTickPosition) + sinceTick / samplesPerTick) / 24.0;
+}
+
+double MidiClock::getJitter() const noexcept
+{
+    return sampleRate > 0.0 ? 1000.0 * std::sqrt (jitterSquared) / sampleRate : 0.0;
+}
+
+void MidiClock::setLocked (const bool isNowLocked)
+{
+    if (locked == isNowLocked)
+        return;
+    locked = isNowLocked;
+    (locked ? acquiredPending : droppedPending).set (1);
+    samplesUntilReport = 0;
+    triggerAsyncUpdate();
+}
+
+void MidiClock::handleAsyncUpdate()
+{
+    if (acquiredPending.compareAndSetBool (0, 1))
+        for (auto* listener : listeners)
+            listener->midiClockSignalAcquired();
+
+    if (droppedPending.compareAndSetBool (0, 1))
+        for (auto* listener : listeners)
+            listener->midiClockSignalDropped();
+
+    const float bpm = tempoToReport.get();
+    if (bpm >= 20.0f && bpm <= 999.0f)
+        for (auto* listener : listeners)
+            listener->midiClockTempoChanged (bpm);
+
+    const double jitter = jitterToReport.get();
+    for (auto* listener : listeners)
+        listener->midiClockJitterChanged (jitter);
 }
 
 void MidiClock::addListener (Listener* listener)
@@ -23,7 +23,15 @@
 
 namespace Element {
     
-class MidiClock
+/** Slaves to incoming MIDI clock.
+
+    Clock, start, continue and song position messages are processed on the
+    audio thread at their sample offsets in the block.  A phase-locked loop
+    filters the tick times, which gives a tempo and a song position that can
+    be used to lock the transport.  Listeners are notified on the message
+    thread.
+*/
+class MidiClock : private AsyncUpdater
 {
 public:
     class Listener
@@ -35,30 +43,82 @@ public:
         virtual void midiClockSignalAcquired() =0;
         virtual void midiClockSignalDropped() =0;
         virtual void midiClockTempoChanged (const float bpm) =0;
+
+        /** Called a few times per second while locked with the RMS jitter
+            of the incoming ticks in milliseconds */
+        virtual void midiClockJitterChanged (const double jitterMs) { ignoreUnused (jitterMs); }
     };
     
     MidiClock() = default;
-    ~MidiClock() { }
+    ~MidiClock() { cancelPendingUpdate(); }
     
-    void process (const MidiMessage& msg);
+    /** Processes a clock, start, continue or song position message received
+        at a sample offset in the current block. Audio thread only. */
+    void process (const MidiMessage& msg, int frame);
+
+    /** Advances to the next block and detects drop outs. Audio thread only. */
+    void advance (int numSamples);
+
+    /** Resets the clock. Not realtime safe */
     void reset (const double sampleRate, const int blockSize);
-    
+
+    /** Returns true if the loop is locked to the incoming clock */
+    bool isLocked() const noexcept { return locked; }
+
+    /** Returns the filtered tempo in beats per minute */
+    double getTempo() const noexcept;
+
+    /** Returns the song position in beats at a sample offset in the current
+        block, extrapolated from the last tick */
+    double getSongPosition (int frame = 0) const noexcept;
+
+    /** Returns the RMS jitter of the incoming ticks in milliseconds */
+    double getJitter() const noexcept;
+
     void addListener (Listener*);
     void removeListener (Listener*);
     
 private:
     double sampleRate = 0.0;
     int blockSize = 0;
-    DelayLockedLoop dll;
-    double timeOfLastUpdate = 0.0;
-    double lastKnownTimeDiff = 0.0;
-    int midiClockTicks = 0;
+
+    // absolute sample position of the start of the current block
+    int64 blockStart = 0;
+
+    // loop state, in samples
+    int64 numTicks = 0;
+    double tickTime = 0.0;
+    double predictedTime = 0.0;
+    double samplesPerTick = 0.0;
+    double jitterSquared = 0.0;
+
+    // song position in ticks of the last and next tick
+    int64 lastTickPosition = -1;
+    int64 nextTickPosition = 0;
+    bool running = false;
+    bool locked = false;
     int syncPeriodTicks = 48;
-    double bpmUpdateSeconds = 1.0;
-    
+
+    Atomic<int> acquiredPending { 0 }, droppedPending { 0 };
+    Atomic<float> tempoToReport { 0.f };
+    Atomic<double> jitterToReport { 0.0 };
+    int samplesUntilReport = 0;
+
     Array<Listener*> listeners;
+
+    void tick (double time);
+    void setLocked (bool);
+    void handleAsyncUpdate() override;
 };
 
+/** Generates MIDI clock from the audio stream.
+
+    Tick times are kept in integer phase units of 1/1000 bpm, where one
+    sample advances the phase by the tempo and a tick is sent each time it
+    crosses 60 * sampleRate.  Ticks stay locked to the sample counter no
+    matter how long it runs.  A tempo change ramps linearly over the next
+    rendered block.
+*/
 class MidiClockMaster
 {
 public:
@@ -66,6 +126,7 @@ public:
     {
         clockMessage = MidiMessage::midiClock();
         updateCoefficients();
+        increment = targetIncrement;
     }
 
     ~MidiClockMaster() noexcept { }
@@ -73,9 +134,12 @@ public:
     inline void reset()
     {
         pos = 0;
+        phase = 0;
         updateCoefficients();
+        increment = targetIncrement;
     }
 
+    /** Sets the tempo reached at the end of the next rendered block */
     inline void setTempo (const double newTempo) noexcept
     {
         if (tempo == newTempo)
@@ -88,38 +152,88 @@ public:
     {
         if (sampleRate == newSampleRate)
             return;
+        const int64 oldPhasePerTick = phasePerTick;
         sampleRate = newSampleRate;
         updateCoefficients();
+        increment = targetIncrement;
+        if (oldPhasePerTick > 0)
+            phase = static_cast<int64> ((double) phase * (double) phasePerTick / (double) oldPhasePerTick);
+    }
+
+    /** Moves the clock to a position in beats. The position is rounded up to
+        the next sixteenth note and the next tick is held back until the
+        stream reaches it. Returns the sixteenth to send in a Song Position
+        Pointer message. */
+    inline int seek (const double beats) noexcept
+    {
+        const int sixteenths = jlimit (0, 16383, static_cast<int> (std::ceil (beats * 4.0 - 1.0e-9)));
+        const double ticksAhead = jmax (0.0, (double) sixteenths * 6.0 - beats * 24.0);
+        phase = phasePerTick - static_cast<int64> (ticksAhead * (double) phasePerTick);
+        return sixteenths;
     }
 
     inline void render (MidiBuffer& midi, int numSamples) noexcept
     {
-        if (samplesPerClock <= 0)
+        if (numSamples <= 0)
             return;
 
-        int frame = static_cast<int> (pos % samplesPerClock);
-        if (frame > 0) frame = samplesPerClock - frame;
-        while (frame < numSamples)
+        if (increment != targetIncrement)
+        {
+            // ramp to the new tempo over this block
+            const int64 start = increment;
+            const int64 delta = targetIncrement - increment;
+            for (int frame = 0; frame < numSamples; ++frame)
+            {
+                if (phase >= phasePerTick)
+                {
+                    midi.addEvent (clockMessage, frame);
+                    phase -= phasePerTick;
+                }
+                phase += start + (delta * (frame + 1)) / numSamples;
+            }
+            increment = targetIncrement;
+        }
+        else if (increment > 0)
         {
-            midi.addEvent (clockMessage, frame);
-            frame += samplesPerClock;
+            int frame = 0;
+            while (frame < numSamples)
+            {
+                const int64 needed = phasePerTick - phase;
+                const int64 wait = needed <= 0 ? 0 : (needed + increment - 1) / increment;
+                if (wait >= (int64) (numSamples - frame))
+                {
+                    phase += increment * (int64) (numSamples - frame);
+                    break;
+                }
+
+                frame += static_cast<int> (wait);
+                phase += increment * wait - phasePerTick;
+                midi.addEvent (clockMessage, frame);
+            }
         }
 
         pos += numSamples;
     }
 
+    /** Returns the number of samples rendered since the last reset */
+    inline int64 getPosition() const noexcept { return pos; }
+
 private:
     MidiMessage clockMessage;
     int64 pos = 0;
     double tempo = 120.0;
     double sampleRate = 44100.0;
-    int samplesPerClock = 0;
-    double clocksPerMinute = 1.0;
+
+    // a tick is 60000 * sampleRate, a sample adds 24000 * tempo
+    int64 phase = 0;
+    int64 phasePerTick = 0;
+    int64 increment = 0;
+    int64 targetIncrement = 0;
 
     void updateCoefficients()
     {
-        clocksPerMinute = 24.f * tempo;
-        samplesPerClock = roundToIntAccurate ((60.0 * sampleRate) / clocksPerMinute);
+        phasePerTick = static_cast<int64> (60000.0 * std::round (sampleRate));
+        targetIncrement = static_cast<int64> (std::llround (24000.0 * jmax (0.0, tempo)));
     }
 };
 
@@ -26,6 +26,7 @@ namespace Element {
 void MidiEngine::applySettings (Settings& settings)
 {
     midiInsFromXml.clear();
+    setMidiOutputLookahead (settings.getMidiOutputLookahead());
 
     if (auto xml = std::unique_ptr<XmlElement> (settings.getUserSettings()->getXmlValue (Settings::midiEngineKey)))
     {
@@ -58,7 +59,7 @@ void MidiEngine::writeSettings (Settings& settings)
     {
         ValueTree input ("input");
         input.setProperty (Tags::name, holder->input->getName(), nullptr)
-             .setProperty (Tags::active, holder->active, nullptr);
+             .setProperty (Tags::active, holder->active.load(), nullptr);
         data.appendChild (input, nullptr);
     }
 
@@ -87,7 +88,6 @@ void MidiEngine::writeSettings (Settings& settings)
 
 //==============================================================================
 class MidiEngine::CallbackHandler  : public AudioIODeviceCallback,
-                                     public MidiInputCallback,
                                      public AudioIODeviceType::Listener
 {
 public:
@@ -114,11 +114,6 @@ private:
         // noop
     }
 
-    void handleIncomingMidiMessage (MidiInput* source, const MidiMessage& message) override
-    {
-        owner.handleIncomingMidiMessageInt (source, message);
-    }
-
     void audioDeviceListChanged() override
     {
         // noop
@@ -129,28 +124,96 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CallbackHandler)
 };
 
+//==============================================================================
+/** Keeps the current callback table alive while it is being dispatched.
+
+    Readers register in the current epoch and writers flip the epoch after
+    publishing a new table, then wait for readers of the previous epoch to
+    leave before deleting the old table.
+ */
+class MidiEngine::ScopedDispatch
+{
+public:
+    ScopedDispatch (MidiEngine& e) noexcept
+        : engine (e)
+    {
+        for (;;)
+        {
+            epoch = engine.dispatchEpoch.load();
+            engine.dispatchReaders[epoch].fetch_add (1);
+            if (epoch == engine.dispatchEpoch.load())
+                break;
+            engine.dispatchReaders[epoch].fetch_sub (1);
+        }
+
+        table = engine.callbackTable.load();
+    }
+
+    ~ScopedDispatch() noexcept
+    {
+        engine.dispatchReaders[epoch].fetch_sub (1);
+    }
+
+    const CallbackTable* get() const noexcept { return table; }
+
+private:
+    MidiEngine& engine;
+    int epoch = 0;
+    const CallbackTable* table = nullptr;
+};
+
+void MidiEngine::updateCallbackTable()
+{
+    std::unique_ptr<CallbackTable> table (new CallbackTable());
+
+    for (const auto& mc : midiCallbacks)
+        table->all.add (Subscriber { mc.callback, mc.consumer });
+
+    for (auto* const holder : openMidiInputs)
+    {
+        Array<Subscriber> subscribers;
+        const auto name = holder->input != nullptr ? holder->input->getName() : String();
+        for (const auto& mc : midiCallbacks)
+            if (mc.deviceName.isEmpty() || mc.deviceName == name)
+                subscribers.add (Subscriber { mc.callback, mc.consumer });
+        table->devices.add (subscribers);
+    }
+
+    std::unique_ptr<CallbackTable> oldTable (callbackTable.exchange (table.release()));
+    const int oldEpoch = dispatchEpoch.load();
+    dispatchEpoch.store (1 - oldEpoch);
+    while (dispatchReaders[oldEpoch].load() > 0)
+        Thread::yield();
+}
+
 void MidiEngine::MidiInputHolder::handleIncomingMidiMessage (MidiInput* source, const MidiMessage& message)
 {
     if (message.isActiveSense())
         return;
 
     jassert (source == input.get());
-    const ScopedLock sl (engine.midiCallbackLock);
+    const bool isActive = active.load();
+    if (isActive)
+        queue.addMessage (message);
 
-    for (auto& mc : engine.midiCallbacks)
-        if ((active || mc.consumer) && (mc.deviceName.isEmpty() || mc.deviceName == input->getName()))
-            mc.callback->handleIncomingMidiMessage (input.get(), message);
+    engine.handleIncomingMidiMessageInt (*this, message, isActive);
 }
 
 //==============================================================================
 MidiEngine::MidiEngine()
 {
+    zerostruct (inputQueues);
+    dispatchReaders[0].store (0);
+    dispatchReaders[1].store (0);
     callbackHandler.reset (new CallbackHandler (*this));
 }
 
 MidiEngine::~MidiEngine()
 {
+    numInputQueues.store (0);
     callbackHandler.reset (nullptr);
+    openMidiInputs.clear();
+    delete callbackTable.exchange (nullptr);
 }
 
 //==============================================================================
@@ -167,12 +230,27 @@ MidiEngine::MidiInputHolder* MidiEngine::getMidiInput (const String& deviceName,
     if (index >= 0)
     {
         std::unique_ptr<MidiInputHolder> holder;
-        holder.reset (new MidiInputHolder (*this));
+        holder.reset (new MidiInputHolder (*this, openMidiInputs.size()));
         if (auto midiIn = MidiInput::openDevice (index, holder.get()))
         {
             holder->input.reset (midiIn.release());
-            holder->input->start();
-            return openMidiInputs.add (holder.release());
+
+            const int numQueues = numInputQueues.load();
+            if (numQueues < maxInputQueues)
+            {
+                holder->queue.reset (inputSampleRate);
+                inputQueues[numQueues] = &holder->queue;
+                numInputQueues.store (numQueues + 1);
+            }
+
+            auto* const opened = openMidiInputs.add (holder.release());
+            {
+                const ScopedLock sl (midiCallbackLock);
+                updateCallbackTable();
+            }
+
+            opened->input->start();
+            return opened;
         }
     }
 
@@ -227,47 +305,61 @@ void MidiEngine::addMidiInputCallback (const String& name, MidiInputCallback* ca
 
         const ScopedLock sl (midiCallbackLock);
         midiCallbacks.add (mc);
+        updateCallbackTable();
     }
 }
 
 void MidiEngine::removeMidiInputCallback (const String& name, MidiInputCallback* callbackToRemove)
 {
+    const ScopedLock sl (midiCallbackLock);
+    bool changed = false;
+
     for (int i = midiCallbacks.size(); --i >= 0;)
     {
         auto& mc = midiCallbacks.getReference (i);
 
         if (mc.callback == callbackToRemove && mc.deviceName == name)
         {
-            const ScopedLock sl (midiCallbackLock);
             midiCallbacks.remove (i);
+            changed = true;
         }
     }
+
+    // once the table is swapped no input thread can still be calling it
+    if (changed)
+        updateCallbackTable();
 }
 
 void MidiEngine::removeMidiInputCallback (MidiInputCallback* callbackToRemove)
 {
+    const ScopedLock sl (midiCallbackLock);
+    bool changed = false;
+
     for (int i = midiCallbacks.size(); --i >= 0;)
     {
         auto& mc = midiCallbacks.getReference (i);
 
         if (mc.callback == callbackToRemove)
         {
-            const ScopedLock sl (midiCallbackLock);
             midiCallbacks.remove (i);
+            changed = true;
         }
     }
+
+    if (changed)
+        updateCallbackTable();
 }
 
-void MidiEngine::handleIncomingMidiMessageInt (MidiInput* source, const MidiMessage& message)
+void MidiEngine::handleIncomingMidiMessageInt (const MidiInputHolder& holder, const MidiMessage& message,
+                                               const bool isActive)
 {
-    if (! message.isActiveSense())
-    {
-        const ScopedLock sl (midiCallbackLock);
-
-        for (auto& mc : midiCallbacks)
-            if (mc.consumer || mc.deviceName.isEmpty() || mc.deviceName == source->getName())
-                mc.callback->handleIncomingMidiMessage (source, message);
-    }
+    // the holder's index is fixed when it opens, so openMidiInputs isn't touched here
+    const ScopedDispatch dispatch (*this);
+    if (auto* table = dispatch.get())
+        if (isPositiveAndBelow (holder.index, table->devices.size()))
+            for (const auto& sub : table->devices.getReference (holder.index))
+                if (isActive || sub.consumer)
+                    sub.callback->handleIncomingMidiMessage (holder.input.get(), message);
 }
 
 void MidiEngine::processMidiBuffer (const MidiBuffer& buffer, int nframes, double sampleRate)
@@ -276,7 +368,10 @@ void MidiEngine::processMidiBuffer (const MidiBuffer& buffer, int nframes, doubl
     MidiMessage message; int frame = 0;
     const double timeNow = 1.5 + Time::getMillisecondCounterHiRes();
     
-    const ScopedLock sl (midiCallbackLock);
+    const ScopedDispatch dispatch (*this);
+    auto* const table = dispatch.get();
+    if (table == nullptr || table->all.isEmpty())
+        return;
 
     while (iter.getNextEvent (message, frame))
     {
@@ -284,11 +379,30 @@ void MidiEngine::processMidiBuffer (const MidiBuffer& buffer, int nframes, doubl
             break;
         
         message.setTimeStamp (timeNow + (1000.0 * (static_cast<double> (frame) / sampleRate)));
-        for (auto& mc : midiCallbacks)
-            mc.callback->handleIncomingMidiMessage (nullptr, message);
+        for (const auto& sub : table->all)
+            sub.callback->handleIncomingMidiMessage (nullptr, message);
     }
 }
 
+void MidiEngine::prepareMidiInputs (double sampleRate)
+{
+    inputSampleRate = sampleRate;
+    const int numQueues = numInputQueues.load();
+    for (int i = 0; i < numQueues; ++i)
+        inputQueues[i]->reset (sampleRate);
+}
+
+void MidiEngine::collectMidiInputs (MidiBuffer& buffer, int numSamples)
+{
+    const int numQueues = numInputQueues.load (std::memory_order_acquire);
+    if (numQueues <= 0)
+        return;
+
+    const double timeNow = Time::getMillisecondCounterHiRes();
+    for (int i = 0; i < numQueues; ++i)
+        inputQueues[i]->removeNextBlockOfMessages (buffer, numSamples, timeNow);
+}
+
 int MidiEngine::getNumActiveMidiInputs() const
 {
     int total = 0;
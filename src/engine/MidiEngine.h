@@ -17,7 +17,9 @@
     Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+#include <atomic>
 #include "JuceHeader.h"
+#include "engine/MidiInputQueue.h"
 
 #pragma once
 
@@ -118,6 +120,32 @@ public:
 
     CriticalSection& getMidiOutputLock() { return midiOutputLock; }
 
+    /** Sets the milliseconds added to the send time of scheduled MIDI output */
+    void setMidiOutputLookahead (double milliseconds)   { midiOutputLookahead.store (milliseconds); }
+
+    /** Returns the milliseconds added to the send time of MIDI output */
+    double getMidiOutputLookahead() const noexcept      { return midiOutputLookahead.load(); }
+
+    /** Sets the samples between rendering audio and hearing it on the
+        current audio device. MIDI output is delayed by this much so it lines
+        up with the audio. */
+    void setAudioOutputLatency (int samples)            { audioOutputLatency.store (samples); }
+
+    /** Returns the audio device output latency in samples */
+    int getAudioOutputLatency() const noexcept          { return audioOutputLatency.load(); }
+
+    //==============================================================================
+    /** Resets the input queues of all open devices. Call this before the audio
+        thread starts collecting input.
+        @see collectMidiInputs
+     */
+    void prepareMidiInputs (double sampleRate);
+
+    /** Moves messages received from active input devices into a buffer. This
+        doesn't lock or allocate and should only be called from the audio thread.
+     */
+    void collectMidiInputs (MidiBuffer& buffer, int numSamples);
+
 private:
     struct MidiCallbackInfo
     {
@@ -132,13 +160,32 @@ private:
         MidiInputCallback* callback;
     };
 
+    /** A callback resolved to an input device */
+    struct Subscriber
+    {
+        MidiInputCallback* callback;
+        bool consumer;
+    };
+
+    /** Immutable snapshot of the callbacks subscribed to each open device.
+        Rebuilt whenever callbacks or devices change and read without locking
+        by the midi input threads.
+     */
+    struct CallbackTable
+    {
+        Array<Subscriber> all;
+        Array<Array<Subscriber>> devices; // indexed by MidiInputHolder::index
+    };
+
     struct MidiInputHolder : public MidiInputCallback
     {
-        MidiInputHolder (MidiEngine& e)
-            : engine (e) { }
+        MidiInputHolder (MidiEngine& e, int i)
+            : index (i), engine (e) { }
 
+        const int index;
         std::unique_ptr<MidiInput> input;
-        bool active = false;  // if true, then will feed to audio engine
+        MidiInputQueue queue;
+        std::atomic<bool> active { false };  // if true, then will feed to audio engine
 
         void handleIncomingMidiMessage (MidiInput* source, const MidiMessage& message) override;
 
@@ -150,6 +197,21 @@ private:
     OwnedArray<MidiInputHolder> openMidiInputs;
     Array<MidiCallbackInfo> midiCallbacks;
 
+    std::atomic<CallbackTable*> callbackTable { nullptr };
+    std::atomic<int> dispatchEpoch { 0 };
+    std::atomic<int> dispatchReaders[2];
+    class ScopedDispatch;
+    void updateCallbackTable();
+
+    // holders are never removed, so the audio thread can read these without locking
+    enum { maxInputQueues = 64 };
+    MidiInputQueue* inputQueues [maxInputQueues];
+    std::atomic<int> numInputQueues { 0 };
+    double inputSampleRate = 44100.0;
+
+    std::atomic<double> midiOutputLookahead { 0.0 };
+    std::atomic<int> audioOutputLatency { 0 };
+
     String defaultMidiOutputName;
     std::unique_ptr<MidiOutput> defaultMidiOutput;
     CriticalSection audioCallbackLock, midiCallbackLock, midiOutputLock;
@@ -158,7 +220,7 @@ private:
     std::unique_ptr<CallbackHandler> callbackHandler;
 
     MidiInputHolder* getMidiInput (const String& deviceName, bool openIfNotAlready);
-    void handleIncomingMidiMessageInt (MidiInput*, const MidiMessage&);
+    void handleIncomingMidiMessageInt (const MidiInputHolder&, const MidiMessage&, bool isActive);
 };
 
 }
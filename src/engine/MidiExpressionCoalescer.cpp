@@ -0,0 +1,182 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/MidiExpressionCoalescer.h"
+
+namespace Element {
+
+// MidiBuffer stores each event as a sample position, a size and the raw data
+static constexpr int midiEventHeaderSize = (int) (sizeof (int32) + sizeof (uint16));
+
+static inline bool isCoalescableController (const int cc) noexcept
+{
+    return ! (cc == 0 || cc == 32          // bank select
+           || cc == 6 || cc == 38          // data entry
+           || (cc >= 64 && cc <= 69)       // pedals and switches, every edge matters
+           || cc == 84                     // portamento control
+           || (cc >= 96 && cc <= 101)      // (N)RPN
+           || cc >= 120);                  // channel mode
+}
+
+void MidiExpressionCoalescer::prepare (int newMaxEvents)
+{
+    newMaxEvents = jmax (0, newMaxEvents);
+    if (newMaxEvents == maxEvents)
+        return;
+
+    maxEvents = newMaxEvents;
+    offsets.calloc ((size_t) maxEvents + 1);
+    keep.calloc ((size_t) maxEvents + 1);
+    counter = 0;
+    resetStamps();
+}
+
+void MidiExpressionCoalescer::resetStamps() noexcept
+{
+    zeromem (bend, sizeof (bend));
+    zeromem (pressure, sizeof (pressure));
+    zeromem (poly, sizeof (poly));
+    zeromem (controller, sizeof (controller));
+    for (auto& stamp : segment)
+        stamp = ++counter;
+}
+
+bool MidiExpressionCoalescer::isRedundant (const uint8* message, int numBytes) noexcept
+{
+    const int status = (int) message[0];
+    if (numBytes <= 0 || status < 0x80 || status >= 0xf0)
+        return false;
+
+    const int channel = status & 0x0f;
+    const uint32 stamp = segment[channel];
+
+    // marks a slot as updated later in this segment, returns true if it already was
+    auto seen = [stamp] (uint32& slot) -> bool
+    {
+        if (slot == stamp)
+            return true;
+        slot = stamp;
+        return false;
+    };
+
+    switch (status & 0xf0)
+    {
+        case 0x80:
+        case 0x90:
+        case 0xc0:
+            segment[channel] = ++counter;
+            return false;
+
+        case 0xe0:
+            return seen (bend[channel]);
+
+        case 0xd0:
+            return seen (pressure[channel]);
+
+        case 0xa0:
+            return numBytes >= 2 && seen (poly[channel][message[1] & 127]);
+
+        case 0xb0:
+        {
+            if (numBytes < 2)
+                return false;
+            const int cc = message[1] & 127;
+            if (! isCoalescableController (cc))
+                return false;
+            if (cc >= 32 && cc < 64 && controller[channel][cc - 32] == stamp)
+                return true;    // a later MSB resets this LSB
+            return seen (controller[channel][cc]);
+        }
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
+int MidiExpressionCoalescer::process (const MidiBuffer& source, MidiBuffer& dest) noexcept
+{
+    const uint8* const data = source.data.begin();
+    const int totalSize = source.data.size();
+    if (totalSize <= 0 || maxEvents <= 0)
+        return 0;
+
+    int numEvents = 0;
+    for (int pos = 0; pos < totalSize;)
+    {
+        if (numEvents >= maxEvents)
+            return 0;
+        uint16 numBytes = 0;
+        memcpy (&numBytes, data + pos + sizeof (int32), sizeof (uint16));
+        offsets[numEvents++] = pos;
+        pos += midiEventHeaderSize + (int) numBytes;
+    }
+    offsets[numEvents] = totalSize;
+
+    // walk backwards so each update knows whether a later one replaces it
+    if (counter > 0xffff0000u)
+    {
+        counter = 0;
+        resetStamps();
+    }
+    else
+    {
+        for (auto& stamp : segment)
+            stamp = ++counter;
+    }
+
+    int numRemoved = 0;
+    for (int i = numEvents; --i >= 0;)
+    {
+        const int pos = offsets[i];
+        const int numBytes = offsets[i + 1] - pos - midiEventHeaderSize;
+        const bool redundant = isRedundant (data + pos + midiEventHeaderSize, numBytes);
+        keep[i] = redundant ? 0 : 1;
+        if (redundant)
+            ++numRemoved;
+    }
+
+    if (numRemoved == 0)
+        return 0;
+
+    // copy runs of kept events
+    if (totalSize > dest.data.getNumAllocated())
+        return 0;
+
+    dest.clear();
+    int runStart = -1;
+    for (int i = 0; i <= numEvents; ++i)
+    {
+        const bool kept = i < numEvents && keep[i] != 0;
+        if (kept && runStart < 0)
+        {
+            runStart = offsets[i];
+        }
+        else if (! kept && runStart >= 0)
+        {
+            dest.data.addArray (data + runStart, offsets[i] - runStart);
+            runStart = -1;
+        }
+    }
+
+    return numRemoved;
+}
+
+}
@@ -0,0 +1,76 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Removes redundant expression updates from a block of MIDI.
+
+    Pitch bend, channel pressure, poly pressure and continuous controllers
+    are reduced to the last value per channel (and per note or controller)
+    between note events on that channel.  With MPE every note has its own
+    channel, so this bounds the per-note expression rate to one update per
+    note segment per block.
+
+    14-bit controllers are kept in pairs: an LSB (CC 32-63) is dropped when
+    a later MSB or LSB for the same controller follows, since a new MSB
+    resets the LSB.  Bank select, data entry, (N)RPN and channel mode
+    messages are never removed.  Note and program change messages are kept
+    and act as boundaries, so expression stays ordered around them.
+*/
+class MidiExpressionCoalescer
+{
+public:
+    MidiExpressionCoalescer() { }
+    ~MidiExpressionCoalescer() { }
+
+    /** Allocates space for blocks of up to maxEvents events. Not realtime safe */
+    void prepare (int maxEvents);
+
+    /** Coalesces a block.  If anything was removed, the result is written to
+        dest, which should be preallocated, and the number of removed events
+        is returned.  Returns 0 and leaves dest alone if nothing could be
+        removed, or if the block has more events than prepared for.
+        Realtime safe. */
+    int process (const MidiBuffer& source, MidiBuffer& dest) noexcept;
+
+private:
+    HeapBlock<int> offsets;
+    HeapBlock<uint8> keep;
+    int maxEvents = 0;
+
+    // each note segment of a channel gets a new stamp, an update was seen
+    // later in the segment if its slot holds the channel's current stamp
+    uint32 counter = 0;
+    uint32 segment [16];
+    uint32 bend [16];
+    uint32 pressure [16];
+    uint32 poly [16][128];
+    uint32 controller [16][128];
+
+    void resetStamps() noexcept;
+    bool isRedundant (const uint8* message, int numBytes) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (MidiExpressionCoalescer)
+};
+
+}
@@ -0,0 +1,145 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/MidiFilterTable.h"
+
+namespace Element {
+
+// MidiBuffer stores each event as a sample position, a size and the raw data
+static constexpr int midiEventHeaderSize = (int) (sizeof (int32) + sizeof (uint16));
+
+void MidiFilterTable::compile (const GraphNode::MidiFilter& filter) noexcept
+{
+    // a single key range is treated as no range, like the node's key range property
+    const bool keyRangeActive = filter.keyHigh - filter.keyLow > 0;
+    channels = filter.channels & 0xffff;
+    programs = filter.programsEnabled;
+
+    for (int channel = 0; channel < 16; ++channel)
+    {
+        const bool channelOn = (channels & (1u << channel)) != 0;
+        for (int note = 0; note < 128; ++note)
+        {
+            const bool inRange = ! keyRangeActive || (note >= filter.keyLow && note <= filter.keyHigh);
+            notes[channel][note] = channelOn && inRange
+                ? static_cast<uint8> ((note + filter.transpose) & 127)
+                : static_cast<uint8> (rejected);
+        }
+    }
+
+    bypassed = channels == 0xffff && filter.transpose == 0 && ! programs
+        && (! keyRangeActive || (filter.keyLow <= 0 && filter.keyHigh >= 127));
+    compiled = filter.pack();
+}
+
+int MidiFilterTable::process (MidiBuffer& midi, MidiBuffer& scratch, int& program) noexcept
+{
+    program = -1;
+    if (bypassed || midi.isEmpty())
+        return 0;
+
+    uint8* const data = midi.data.getRawDataPointer();
+    const int totalSize = midi.data.size();
+    int pos = 0, keptFrom = 0, numDropped = 0;
+    bool copying = false;
+
+    // copies the run of kept events before 'end' to the scratch buffer, or as
+    // many of them as fit, counting each one that doesn't
+    auto flush = [&] (const int end)
+    {
+        if (end <= keptFrom)
+            return;
+        if (scratch.data.size() + (end - keptFrom) <= scratch.data.getNumAllocated())
+        {
+            scratch.data.addArray (data + keptFrom, end - keptFrom);
+            return;
+        }
+
+        for (int event = keptFrom; event < end;)
+        {
+            uint16 eventBytes = 0;
+            memcpy (&eventBytes, data + event + sizeof (int32), sizeof (uint16));
+            const int size = midiEventHeaderSize + (int) eventBytes;
+            if (scratch.data.size() + size <= scratch.data.getNumAllocated())
+                scratch.data.addArray (data + event, size);
+            else
+                ++numDropped;
+            event += size;
+        }
+    };
+
+    while (pos < totalSize)
+    {
+        uint16 numBytes = 0;
+        memcpy (&numBytes, data + pos + sizeof (int32), sizeof (uint16));
+        const int eventSize = midiEventHeaderSize + (int) numBytes;
+        uint8* const message = data + pos + midiEventHeaderSize;
+
+        bool keep = true;
+        const int status = (int) message[0];
+        if (numBytes > 0 && status >= 0x80 && status < 0xf0)
+        {
+            const int type = status & 0xf0;
+            const int channel = status & 0x0f;
+
+            if ((type == 0x80 || type == 0x90) && numBytes >= 2)
+            {
+                const uint8 note = notes[channel][message[1] & 127];
+                if (note == rejected)
+                    keep = false;
+                else
+                    message[1] = note;
+            }
+            else if ((channels & (1u << channel)) == 0)
+            {
+                keep = false;
+            }
+            else if (programs && type == 0xc0 && numBytes >= 2)
+            {
+                program = (int) message[1];
+                keep = false;
+            }
+        }
+
+        if (! keep)
+        {
+            if (! copying)
+            {
+                scratch.clear();
+                copying = true;
+            }
+
+            flush (pos);
+            keptFrom = pos + eventSize;
+        }
+
+        pos += eventSize;
+    }
+
+    if (copying)
+    {
+        flush (totalSize);
+        midi.swapWith (scratch);
+        scratch.clear();
+    }
+
+    return numDropped;
+}
+
+}
@@ -0,0 +1,69 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/GraphNode.h"
+
+namespace Element {
+
+/** A node's MIDI filter settings compiled into a lookup table.
+
+    Notes are looked up by channel and note number in a 16x128 table which
+    holds the transposed note, or a marker for notes that are filtered out.
+    Other channel messages are checked against a channel mask.  A block is
+    filtered in one pass over the raw events; events are edited in place and
+    only copied when something is removed.
+*/
+class MidiFilterTable
+{
+public:
+    MidiFilterTable() { compile (GraphNode::MidiFilter()); }
+    ~MidiFilterTable() { }
+
+    /** Recompiles the table if the settings changed. Realtime safe */
+    void update (const GraphNode::MidiFilter& filter) noexcept
+    {
+        const uint64 bits = filter.pack();
+        if (bits != compiled)
+            compile (filter);
+    }
+
+    /** Returns true if the settings let everything through unchanged */
+    bool isBypassed() const noexcept { return bypassed; }
+
+    /** Filters a buffer.  If events are removed, the result is built in the
+        scratch buffer, which should be preallocated, and swapped in.  Program
+        changes are removed when programs are enabled; the last one is
+        returned in 'program', which is otherwise -1.  Returns the number of
+        events dropped because the scratch buffer was full. */
+    int process (MidiBuffer& midi, MidiBuffer& scratch, int& program) noexcept;
+
+private:
+    enum { rejected = 0xff };
+    uint8 notes [16][128];
+    uint32 channels = 0xffff;
+    bool programs = false;
+    bool bypassed = true;
+    uint64 compiled = 0;
+
+    void compile (const GraphNode::MidiFilter& filter) noexcept;
+};
+
+}
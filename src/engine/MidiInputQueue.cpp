@@ -0,0 +1,158 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/MidiInputQueue.h"
+
+namespace Element {
+
+MidiInputQueue::MidiInputQueue (int capacityInBytes)
+{
+    capacity = (uint32) nextPowerOfTwo (jmax (256, capacityInBytes));
+    mask = capacity - 1;
+    data.calloc (capacity);
+    scratch.calloc (capacity);
+}
+
+MidiInputQueue::~MidiInputQueue() { }
+
+void MidiInputQueue::copyIn (uint32 pos, const void* src, uint32 numBytes) noexcept
+{
+    const uint32 start = pos & mask;
+    const uint32 first = jmin (numBytes, capacity - start);
+    memcpy (data + start, src, first);
+    if (first < numBytes)
+        memcpy (data.getData(), static_cast<const uint8*> (src) + first, numBytes - first);
+}
+
+void MidiInputQueue::copyOut (uint32 pos, void* dst, uint32 numBytes) const noexcept
+{
+    const uint32 start = pos & mask;
+    const uint32 first = jmin (numBytes, capacity - start);
+    memcpy (dst, data + start, first);
+    if (first < numBytes)
+        memcpy (static_cast<uint8*> (dst) + first, data.getData(), numBytes - first);
+}
+
+bool MidiInputQueue::addMessage (const MidiMessage& message)
+{
+    return addMessage (message.getRawData(), message.getRawDataSize(),
+                       Time::getMillisecondCounterHiRes());
+}
+
+bool MidiInputQueue::addMessage (const uint8* bytes, int numBytes, double timeMs) noexcept
+{
+    if (numBytes <= 0)
+        return true;
+
+    const uint32 recordSize = (uint32) sizeof (Header) + (uint32) numBytes;
+    const uint32 write = writePos.load (std::memory_order_relaxed);
+    const uint32 read  = readPos.load (std::memory_order_acquire);
+
+    if (capacity - (write - read) < recordSize)
+    {
+        numDropped.fetch_add (1, std::memory_order_relaxed);
+        return false;
+    }
+
+    Header header;
+    header.timeMs   = timeMs;
+    header.size     = (int32) numBytes;
+    header.reserved = 0;
+    copyIn (write, &header, sizeof (Header));
+    copyIn (write + (uint32) sizeof (Header), bytes, (uint32) numBytes);
+    writePos.store (write + recordSize, std::memory_order_release);
+    return true;
+}
+
+void MidiInputQueue::reset (double newSampleRate)
+{
+    if (newSampleRate > 0.0)
+        sampleRate = newSampleRate;
+    readPos.store (writePos.load (std::memory_order_acquire), std::memory_order_release);
+}
+
+void MidiInputQueue::removeNextBlockOfMessages (MidiBuffer& buffer, int numSamples)
+{
+    removeNextBlockOfMessages (buffer, numSamples, Time::getMillisecondCounterHiRes());
+}
+
+void MidiInputQueue::removeNextBlockOfMessages (MidiBuffer& buffer, int numSamples, double timeNowMs)
+{
+    if (numSamples <= 0)
+        return;
+
+    const uint32 write = writePos.load (std::memory_order_acquire);
+    uint32 read = readPos.load (std::memory_order_relaxed);
+    if (read == write)
+        return;
+
+    // events are placed in a window of one block ending now
+    const double samplesPerMs = sampleRate * 0.001;
+    const double blockStartMs = timeNowMs - (double) numSamples / samplesPerMs;
+
+    while (read != write)
+    {
+        Header header;
+        copyOut (read, &header, sizeof (Header));
+        if (header.timeMs > timeNowMs)
+            break;  // arrived after this block started processing
+
+        const uint32 numBytes = (uint32) header.size;
+        copyOut (read + (uint32) sizeof (Header), scratch.getData(), numBytes);
+
+        const int offset = jlimit (0, numSamples - 1,
+            roundToInt ((header.timeMs - blockStartMs) * samplesPerMs));
+        buffer.addEvent (scratch.getData(), (int) numBytes, offset);
+
+        read += (uint32) sizeof (Header) + numBytes;
+    }
+
+    readPos.store (read, std::memory_order_release);
+}
+
+bool MidiInputQueue::getNextMessageTime (double& timeMs) const noexcept
+{
+    const uint32 read = readPos.load (std::memory_order_relaxed);
+    if (read == writePos.load (std::memory_order_acquire))
+        return false;
+
+    Header header;
+    copyOut (read, &header, sizeof (Header));
+    timeMs = header.timeMs;
+    return true;
+}
+
+bool MidiInputQueue::removeNextMessage (MidiMessage& message, double& timeMs)
+{
+    const uint32 read = readPos.load (std::memory_order_relaxed);
+    if (read == writePos.load (std::memory_order_acquire))
+        return false;
+
+    Header header;
+    copyOut (read, &header, sizeof (Header));
+    const uint32 numBytes = (uint32) header.size;
+    copyOut (read + (uint32) sizeof (Header), scratch.getData(), numBytes);
+    message = MidiMessage (scratch.getData(), (int) numBytes, header.timeMs * 0.001);
+    timeMs = header.timeMs;
+
+    readPos.store (read + (uint32) sizeof (Header) + numBytes, std::memory_order_release);
+    return true;
+}
+
+}
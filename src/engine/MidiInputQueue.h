@@ -0,0 +1,106 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include <atomic>
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** A single producer, single consumer queue of raw MIDI bytes which carries
+    messages from a MIDI input thread to the audio thread.
+
+    Messages are stamped with Time::getMillisecondCounterHiRes() when they
+    arrive.  The audio thread drains the queue without locking or allocating
+    and places each message within the block relative to when the block
+    started, so events keep their relative timing at a constant latency of
+    one block.  If the queue is full, new messages are dropped and counted.
+
+    Messages can also be removed one at a time, which MidiOutputScheduler uses
+    to move scheduled output from the audio thread to its sending thread.
+*/
+class MidiInputQueue
+{
+public:
+    /** Create a queue.  The capacity is rounded up to a power of two */
+    explicit MidiInputQueue (int capacityInBytes = 65536);
+    ~MidiInputQueue();
+
+    //==========================================================================
+    /** Adds a message stamped with the current time. Call from the producer
+        thread only. Returns false if the message was dropped. */
+    bool addMessage (const MidiMessage& message);
+
+    /** Adds raw MIDI data with a timestamp in milliseconds. Call from the
+        producer thread only. Returns false if the message was dropped. */
+    bool addMessage (const uint8* data, int numBytes, double timeMs) noexcept;
+
+    //==========================================================================
+    /** Discards pending messages and sets the sample rate used for placing
+        events. Must not be called while the consumer is running */
+    void reset (double sampleRate);
+
+    /** Moves all messages received up to now into a MidiBuffer.  The buffer
+        is not cleared first. Call from the consumer thread only */
+    void removeNextBlockOfMessages (MidiBuffer& buffer, int numSamples);
+
+    /** Same as above but with an explicit time in milliseconds for 'now' */
+    void removeNextBlockOfMessages (MidiBuffer& buffer, int numSamples, double timeNowMs);
+
+    /** Gets the timestamp of the next message without removing it. Returns
+        false if the queue is empty. Call from the consumer thread only */
+    bool getNextMessageTime (double& timeMs) const noexcept;
+
+    /** Removes the next message. Returns false if the queue is empty.
+        Call from the consumer thread only */
+    bool removeNextMessage (MidiMessage& message, double& timeMs);
+
+    //==========================================================================
+    /** Returns the number of messages dropped because the queue was full */
+    int getNumDroppedMessages() const noexcept  { return numDropped.load (std::memory_order_relaxed); }
+
+    /** Returns true if there are messages waiting to be removed */
+    bool hasPendingMessages() const noexcept
+    {
+        return readPos.load (std::memory_order_acquire) != writePos.load (std::memory_order_acquire);
+    }
+
+private:
+    struct Header
+    {
+        double timeMs;
+        int32 size;
+        int32 reserved;
+    };
+
+    HeapBlock<uint8> data, scratch;
+    uint32 capacity = 0, mask = 0;
+    std::atomic<uint32> writePos { 0 };
+    std::atomic<uint32> readPos { 0 };
+    std::atomic<int> numDropped { 0 };
+    double sampleRate = 44100.0;
+
+    void copyIn (uint32 pos, const void* src, uint32 numBytes) noexcept;
+    void copyOut (uint32 pos, void* dst, uint32 numBytes) const noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiInputQueue)
+};
+
+}
@@ -0,0 +1,217 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/MidiOutputScheduler.h"
+
+namespace Element {
+
+// the timebase relocks if a callback is off by more than this, e.g. after an xrun
+static const double relockThresholdMs = 50.0;
+
+// messages closer than this to their due time are sent without waiting
+static const double sendToleranceMs = 0.1;
+
+// messages this late count as late in the stats
+static const double lateThresholdMs = 1.0;
+
+//==============================================================================
+void MidiOutputScheduler::Timebase::reset (double newSampleRate, double newBandwidth)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    bandwidth = jmax (0.01, newBandwidth);
+    nominalMsPerSample = 1000.0 / sampleRate;
+    msPerSample = nominalMsPerSample;
+    time = 0.0;
+    position = 0;
+    lastNumSamples = 0;
+    locked = false;
+}
+
+double MidiOutputScheduler::Timebase::update (double timeNowMs, int numSamples)
+{
+    if (! locked || lastNumSamples <= 0)
+    {
+        time = timeNowMs;
+        msPerSample = nominalMsPerSample;
+        locked = true;
+    }
+    else
+    {
+        position += lastNumSamples;
+        const double predicted = time + (double) lastNumSamples * msPerSample;
+        const double error = timeNowMs - predicted;
+
+        if (std::abs (error) > relockThresholdMs)
+        {
+            time = timeNowMs;
+            msPerSample = nominalMsPerSample;
+        }
+        else
+        {
+            // second order delay-locked loop, see F. Adriaensen,
+            // "Using a DLL to filter time"
+            const double omega = 2.0 * double_Pi * bandwidth * (double) lastNumSamples / sampleRate;
+            time = predicted + std::sqrt (2.0) * omega * error;
+            msPerSample += omega * omega * error / (double) lastNumSamples;
+        }
+    }
+
+    lastNumSamples = numSamples;
+    return time;
+}
+
+//==============================================================================
+MidiOutputScheduler::MidiOutputScheduler()
+    : Thread ("el.midi.output") { }
+
+MidiOutputScheduler::~MidiOutputScheduler()
+{
+    release();
+}
+
+void MidiOutputScheduler::setLookahead (double milliseconds)
+{
+    lookahead.store (jlimit (-100.0, 100.0, milliseconds));
+}
+
+void MidiOutputScheduler::prepare (double sampleRate, int latencySamples)
+{
+    release();
+    latency = jmax (0, latencySamples);
+    timebase.reset (sampleRate);
+    queue.reset (sampleRate);
+    startThread (9);
+}
+
+void MidiOutputScheduler::release()
+{
+    stopThread (500);
+    queue.reset (0.0);
+
+    const auto stats = getStats();
+    if (stats.numSent > 0)
+    {
+        Logger::writeToLog (String ("[EL] MIDI output timing: ") + String (stats.numSent) + " sent, "
+            + String (stats.numLate) + " late, average error " + String (stats.averageErrorMs, 2)
+            + " ms, max " + String (stats.maxErrorMs, 2) + " ms");
+    }
+    resetStats();
+}
+
+void MidiOutputScheduler::scheduleBlock (const MidiBuffer& buffer, int numSamples)
+{
+    const double blockTime = timebase.update (Time::getMillisecondCounterHiRes(), numSamples);
+    if (buffer.isEmpty() || ! isThreadRunning())
+        return;
+
+    const double msPerSample = timebase.getMillisecondsPerSample();
+    const double startTime = blockTime + (double) latency * msPerSample + lookahead.load();
+
+    MidiBuffer::Iterator iter (buffer);
+    const uint8* data = nullptr;
+    int numBytes = 0, frame = 0;
+    bool added = false;
+    while (iter.getNextEvent (data, numBytes, frame))
+    {
+        if (frame >= numSamples)
+            break;
+        queue.addMessage (data, numBytes, startTime + (double) frame * msPerSample);
+        added = true;
+    }
+
+    // only wake the sending thread if it went to sleep on an empty queue
+    if (added && idle.exchange (false))
+        notify();
+}
+
+void MidiOutputScheduler::run()
+{
+    MidiMessage message;
+    double due = 0.0;
+
+    while (! threadShouldExit())
+    {
+        if (! queue.getNextMessageTime (due))
+        {
+            // scheduleBlock() sees the flag and signals, a signal sent before
+            // the wait starts isn't lost
+            idle.store (true);
+            if (! queue.getNextMessageTime (due))
+                wait (-1);
+            idle.store (false);
+            continue;
+        }
+
+        // sleep until close to the due time, then yield the rest
+        const double remaining = due - Time::getMillisecondCounterHiRes();
+        if (remaining > 1.5)
+        {
+            wait (jmax (1, roundToInt (remaining - 1.0)));
+            continue;
+        }
+
+        while (due - Time::getMillisecondCounterHiRes() > sendToleranceMs)
+        {
+            if (threadShouldExit())
+                return;
+            Thread::yield();
+        }
+
+        if (queue.removeNextMessage (message, due))
+        {
+            if (onSend)
+                onSend (message);
+            sent (due);
+        }
+    }
+}
+
+void MidiOutputScheduler::sent (double dueMs)
+{
+    const double error = std::abs (Time::getMillisecondCounterHiRes() - dueMs);
+    const auto errorUs = static_cast<int64> (error * 1000.0);
+
+    numSent.fetch_add (1);
+    totalErrorUs.fetch_add (errorUs);
+    if (error > lateThresholdMs)
+        numLate.fetch_add (1);
+    if (errorUs > maxErrorUs.load())
+        maxErrorUs.store (errorUs);
+}
+
+MidiOutputScheduler::Stats MidiOutputScheduler::getStats() const
+{
+    Stats stats;
+    stats.numSent   = numSent.load();
+    stats.numLate   = numLate.load();
+    stats.maxErrorMs = static_cast<double> (maxErrorUs.load()) * 0.001;
+    if (stats.numSent > 0)
+        stats.averageErrorMs = static_cast<double> (totalErrorUs.load()) * 0.001 / (double) stats.numSent;
+    return stats;
+}
+
+void MidiOutputScheduler::resetStats()
+{
+    numSent.store (0);
+    numLate.store (0);
+    totalErrorUs.store (0);
+    maxErrorUs.store (0);
+}
+
+}
@@ -0,0 +1,128 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include "engine/MidiInputQueue.h"
+
+namespace Element {
+
+/** Sends MIDI rendered on the audio thread at the time it will be heard.
+
+    Send times are derived from the number of samples the audio device has
+    streamed. A delay-locked loop smooths the audio callback times into a
+    timebase, so output doesn't follow callback wake-up jitter. The audio
+    output latency is added to every send time, plus a configurable
+    lookahead. Messages are handed to a high priority thread which sends each
+    one when it is due and keeps statistics on how close it got, which are
+    written to the log when the scheduler is released.
+*/
+class MidiOutputScheduler : private Thread
+{
+public:
+    /** Converts stream positions to times in milliseconds on the
+        Time::getMillisecondCounterHiRes() clock */
+    class Timebase
+    {
+    public:
+        Timebase() { }
+
+        /** Resets the loop.  Bandwidth is in Hz, lower filters more jitter
+            but follows clock drift more slowly */
+        void reset (double sampleRate, double bandwidth = 1.0);
+
+        /** Updates the loop with the time a block was received and returns
+            the filtered time of its first sample */
+        double update (double timeNowMs, int numSamples);
+
+        /** Filtered length of a sample in milliseconds */
+        double getMillisecondsPerSample() const noexcept { return msPerSample; }
+
+        /** Number of samples streamed before the current block */
+        int64 getStreamPosition() const noexcept { return position; }
+
+    private:
+        double sampleRate = 44100.0, bandwidth = 1.0;
+        double nominalMsPerSample = 1000.0 / 44100.0;
+        double msPerSample = nominalMsPerSample;
+        double time = 0.0;
+        int64 position = 0;
+        int lastNumSamples = 0;
+        bool locked = false;
+    };
+
+    /** Timing accuracy of sent messages */
+    struct Stats
+    {
+        int64 numSent = 0;
+        int64 numLate = 0;          // sent more than a millisecond late
+        double averageErrorMs = 0.0;
+        double maxErrorMs = 0.0;
+    };
+
+    MidiOutputScheduler();
+    ~MidiOutputScheduler();
+
+    /** Called on the sending thread for each message when it is due */
+    std::function<void(const MidiMessage&)> onSend;
+
+    /** Sets extra time in milliseconds added to every send time. This can be
+        negative to compensate for a slow MIDI interface */
+    void setLookahead (double milliseconds);
+
+    /** Returns the lookahead in milliseconds */
+    double getLookahead() const noexcept { return lookahead.load(); }
+
+    /** Resets the timebase and starts the sending thread. The latency is the
+        number of samples between rendering audio and hearing it. */
+    void prepare (double sampleRate, int latencySamples);
+
+    /** Stops the sending thread and discards pending messages */
+    void release();
+
+    /** Schedules a block of MIDI rendered on the audio thread. Call this for
+        every block, even if empty, so the timebase stays locked. This doesn't
+        lock or allocate. */
+    void scheduleBlock (const MidiBuffer& buffer, int numSamples);
+
+    /** Returns timing statistics of the messages sent so far */
+    Stats getStats() const;
+
+    /** Clears the statistics */
+    void resetStats();
+
+private:
+    MidiInputQueue queue;
+    Timebase timebase;
+    int latency = 0;
+    std::atomic<double> lookahead { 0.0 };
+    std::atomic<bool> idle { false };
+
+    std::atomic<int64> numSent { 0 }, numLate { 0 };
+    std::atomic<int64> totalErrorUs { 0 }, maxErrorUs { 0 };
+
+    void run() override;
+    void sent (double dueMs);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiOutputScheduler)
+};
+
+}
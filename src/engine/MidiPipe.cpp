@@ -88,4 +88,61 @@ void MidiPipe::clear (int channel, int startSample, int numSamples)
         buffer->clear (startSample, numSamples);
 }
 
+//==============================================================================
+// MidiBuffer stores each event as a sample position, a size and the raw data
+static constexpr int midiEventHeaderSize = (int) (sizeof (int32) + sizeof (uint16));
+
+static inline bool hasSpaceFor (const MidiBuffer& buffer, const int numBytes) noexcept
+{
+    return buffer.data.size() + numBytes <= buffer.data.getNumAllocated();
+}
+
+int MidiPipe::getBufferSizeForBlockSize (int blockSize) noexcept
+{
+    // room for a few short messages per sample, or a burst of sysex
+    return jmax (4096, blockSize * 4 * (midiEventHeaderSize + 3));
+}
+
+bool MidiPipe::addEvent (MidiBuffer& dest, const uint8* data, int numBytes, int frame) noexcept
+{
+    if (! hasSpaceFor (dest, midiEventHeaderSize + numBytes))
+        return false;
+    dest.addEvent (data, numBytes, frame);
+    return true;
+}
+
+int MidiPipe::addEvents (MidiBuffer& dest, const MidiBuffer& source, int startSample,
+                         int numSamples, int sampleDeltaToAdd) noexcept
+{
+    if (source.isEmpty())
+        return 0;
+
+    if (hasSpaceFor (dest, source.data.size()))
+    {
+        dest.addEvents (source, startSample, numSamples, sampleDeltaToAdd);
+        return 0;
+    }
+
+    int numDropped = 0;
+    MidiBuffer::Iterator iter (source);
+    iter.setNextSamplePosition (startSample);
+    const uint8* data = nullptr;
+    int numBytes = 0, frame = 0;
+    while (iter.getNextEvent (data, numBytes, frame))
+    {
+        if (numSamples >= 0 && frame >= startSample + numSamples)
+            break;
+        if (! addEvent (dest, data, numBytes, frame + sampleDeltaToAdd))
+            ++numDropped;
+    }
+
+    return numDropped;
+}
+
+int MidiPipe::copyEvents (MidiBuffer& dest, const MidiBuffer& source, int numSamples) noexcept
+{
+    dest.clear();
+    return addEvents (dest, source, 0, numSamples, 0);
+}
+
 }
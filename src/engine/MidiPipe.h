@@ -40,6 +40,25 @@ public:
     void clear (int startSample, int numSamples);
     void clear (int index, int startSample, int numSamples);
 
+    //==========================================================================
+    /** Returns the number of bytes to preallocate in a MidiBuffer which
+        renders blocks of the given size */
+    static int getBufferSizeForBlockSize (int blockSize) noexcept;
+
+    /** Adds an event to a preallocated buffer without growing it. Returns
+        false if it doesn't fit. Realtime safe */
+    static bool addEvent (MidiBuffer& dest, const uint8* data, int numBytes, int frame) noexcept;
+
+    /** Adds a range of events to a preallocated buffer without growing it,
+        like MidiBuffer::addEvents(). Returns the number of events that didn't
+        fit. Realtime safe */
+    static int addEvents (MidiBuffer& dest, const MidiBuffer& source, int startSample,
+                          int numSamples, int sampleDeltaToAdd) noexcept;
+
+    /** Replaces the contents of a preallocated buffer without growing it.
+        Returns the number of events that didn't fit. Realtime safe */
+    static int copyEvents (MidiBuffer& dest, const MidiBuffer& source, int numSamples) noexcept;
+
 private:
     enum { maxReferencedBuffers = 32 };
     int size = 0;
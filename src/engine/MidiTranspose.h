@@ -26,15 +26,8 @@ namespace Element {
 class MidiTranspose
 {
 public:
-    MidiTranspose()
-    {
-        output.ensureSize (sizeof (uint8) * 3 * 16);
-    }
-
-    ~MidiTranspose()
-    { 
-        output.clear();
-    }
+    MidiTranspose() { }
+    ~MidiTranspose() { }
 
     /** Set the note offset to transpose by. e.g -12 is down one octave */
     inline void setNoteOffset (const int noteOffset) { offset.set (noteOffset); }
@@ -56,31 +49,32 @@ public:
             message.setNoteNumber (offset.get() + message.getNoteNumber());
     }
 
-    /** Process a MidiBuffer */
+    /** Process a MidiBuffer in place */
     inline void process (MidiBuffer& midi, int numSamples)
     {
-        if (0 == offset.get())
+        const int noteOffset = offset.get();
+        if (0 == noteOffset)
             return;
 
+        // only the note number changes, so the buffer is edited directly
         MidiBuffer::Iterator iter (midi);
-        MidiMessage msg; int frame = 0;
+        const uint8* data = nullptr;
+        int numBytes = 0, frame = 0;
         
-        while (iter.getNextEvent (msg, frame))
+        while (iter.getNextEvent (data, numBytes, frame))
         {
             if (frame >= numSamples)
                 break;
-            if (msg.isNoteOnOrOff())
-                msg.setNoteNumber (offset.get() + msg.getNoteNumber());
-            output.addEvent (msg, frame);
+            if (numBytes >= 2 && (data[0] & 0xe0) == 0x80)
+            {
+                auto* const note = const_cast<uint8*> (data + 1);
+                *note = static_cast<uint8> ((noteOffset + (int) *note) & 127);
+            }
         }
-
-        midi.swapWith (output);
-        output.clear();
     }
 
 private:
     Atomic<int> offset { 0 };
-    MidiBuffer output;
 };
 
 }
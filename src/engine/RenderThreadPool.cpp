@@ -0,0 +1,253 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include <thread>
+#include "engine/RenderThreadPool.h"
+
+namespace Element {
+
+// number of polls a worker makes for new work before going to sleep
+static const int workerSpinCount = 2000;
+
+// MARK: RenderSchedule
+
+RenderSchedule::RenderSchedule() { }
+RenderSchedule::~RenderSchedule() { }
+
+int RenderSchedule::addStage()
+{
+    successors.add (Array<int>());
+    numDependencies.add (0);
+    return numStages++;
+}
+
+void RenderSchedule::addDependency (int dependency, int stage)
+{
+    jassert (isPositiveAndBelow (dependency, numStages));
+    jassert (isPositiveAndBelow (stage, numStages));
+    jassert (dependency < stage); // stages can only depend on earlier stages
+
+    auto& next = successors.getReference (dependency);
+    if (next.contains (stage))
+        return;
+    next.add (stage);
+    numDependencies.set (stage, numDependencies[stage] + 1);
+}
+
+void RenderSchedule::finalize()
+{
+    roots.clearQuick();
+    for (int i = 0; i < numStages; ++i)
+        if (numDependencies.getUnchecked (i) == 0)
+            roots.add (i);
+
+    // stages are already in topological order
+    Array<int> depth;
+    depth.insertMultiple (0, 1, numStages);
+    criticalPath = numStages > 0 ? 1 : 0;
+    for (int i = 0; i < numStages; ++i)
+    {
+        for (const auto next : successors.getReference (i))
+        {
+            depth.set (next, jmax (depth[next], depth[i] + 1));
+            criticalPath = jmax (criticalPath, depth[next]);
+        }
+    }
+
+    pending.reset (new std::atomic<int> [(size_t) jmax (1, numStages)]);
+    ready.reset (new std::atomic<int> [(size_t) jmax (1, numStages)]);
+    for (int i = 0; i < numStages; ++i)
+    {
+        pending[i].store (numDependencies.getUnchecked (i));
+        ready[i].store (-1);
+    }
+}
+
+void RenderSchedule::performSerial (Performer& p)
+{
+    for (int i = 0; i < numStages; ++i)
+        p.performStage (i);
+}
+
+void RenderSchedule::begin (Performer& p)
+{
+    jassert (pending != nullptr && ready != nullptr);
+    performer = &p;
+    for (int i = 0; i < numStages; ++i)
+    {
+        pending[i].store (numDependencies.getUnchecked (i), std::memory_order_relaxed);
+        ready[i].store (-1, std::memory_order_relaxed);
+    }
+
+    readHead.store (0, std::memory_order_relaxed);
+    writeHead.store (0, std::memory_order_relaxed);
+    numRemaining.store (numStages, std::memory_order_relaxed);
+
+    for (const auto stage : roots)
+        push (stage);
+}
+
+void RenderSchedule::push (int stage) noexcept
+{
+    // every stage is pushed exactly once per cycle, so the queue can't overflow
+    const int slot = writeHead.fetch_add (1, std::memory_order_acq_rel);
+    jassert (slot < numStages);
+    ready[slot].store (stage, std::memory_order_release);
+}
+
+int RenderSchedule::pop() noexcept
+{
+    int head = readHead.load (std::memory_order_acquire);
+    while (head < writeHead.load (std::memory_order_acquire))
+    {
+        if (readHead.compare_exchange_weak (head, head + 1, std::memory_order_acq_rel))
+        {
+            int stage = -1;
+            // the slot was reserved by push() but might not be written yet
+            while ((stage = ready[head].load (std::memory_order_acquire)) < 0) { }
+            return stage;
+        }
+    }
+
+    return -1;
+}
+
+void RenderSchedule::execute() noexcept
+{
+    while (numRemaining.load (std::memory_order_acquire) > 0)
+    {
+        const int stage = pop();
+        if (stage < 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        performer->performStage (stage);
+
+        for (const auto next : successors.getReference (stage))
+            if (pending[next].fetch_sub (1, std::memory_order_acq_rel) == 1)
+                push (next);
+
+        numRemaining.fetch_sub (1, std::memory_order_acq_rel);
+    }
+}
+
+// MARK: RenderThreadPool
+
+class RenderThreadPool::Worker : public Thread
+{
+public:
+    Worker (RenderThreadPool& p, int index)
+        : Thread ("el.render." + String (index)), pool (p) { }
+
+    ~Worker()
+    {
+        signalThreadShouldExit();
+        wakeup.signal();
+        stopThread (500);
+    }
+
+    void run() override
+    {
+        // match the device callback so stages render the same on any thread
+        ScopedNoDenormals noDenormals;
+        uint32 lastGeneration = pool.generation.load();
+
+        while (! threadShouldExit())
+        {
+            int spins = 0;
+            while (pool.generation.load (std::memory_order_acquire) == lastGeneration)
+            {
+                if (threadShouldExit())
+                    return;
+                if (++spins < workerSpinCount)
+                    continue;
+
+                pool.numSleeping.fetch_add (1);
+                if (pool.generation.load() == lastGeneration)
+                    wakeup.wait (-1);
+                pool.numSleeping.fetch_sub (1);
+                spins = 0;
+            }
+
+            lastGeneration = pool.generation.load();
+
+            pool.numActive.fetch_add (1);
+            if (auto* schedule = pool.current.load())
+                schedule->execute();
+            pool.numActive.fetch_sub (1);
+        }
+    }
+
+    WaitableEvent wakeup;
+
+private:
+    RenderThreadPool& pool;
+};
+
+RenderThreadPool::RenderThreadPool (int numWorkers)
+{
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto* worker = workers.add (new Worker (*this, i + 1));
+        worker->startThread (10);
+    }
+}
+
+RenderThreadPool::~RenderThreadPool()
+{
+    jassert (! isPerforming());
+    workers.clear();
+}
+
+int RenderThreadPool::getDefaultNumWorkers()
+{
+    return jmax (0, SystemStats::getNumCpus() - 1);
+}
+
+void RenderThreadPool::perform (RenderSchedule& schedule, RenderSchedule::Performer& performer)
+{
+    jassert (! isPerforming());
+    if (workers.size() <= 0)
+    {
+        schedule.performSerial (performer);
+        return;
+    }
+
+    performing.store (true, std::memory_order_release);
+    schedule.begin (performer);
+    current.store (&schedule);
+    generation.fetch_add (1);
+
+    if (numSleeping.load() > 0)
+        for (auto* worker : workers)
+            worker->wakeup.signal();
+
+    schedule.execute();
+
+    // wait for workers still inside the schedule before it can be reused
+    current.store (nullptr);
+    while (numActive.load() > 0)
+        std::this_thread::yield();
+
+    performing.store (false, std::memory_order_release);
+}
+
+}
@@ -0,0 +1,137 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include "JuceHeader.h"
+
+namespace Element {
+
+class RenderThreadPool;
+
+/** A set of render stages and the dependencies between them.
+
+    Stages are added in serial render order and a stage can only depend on
+    stages added before it, so performing the stages in index order is always
+    a valid (serial) schedule.  Once finalized, a RenderThreadPool can execute
+    independent stages concurrently.
+*/
+class RenderSchedule
+{
+public:
+    /** Renders a single stage of a schedule */
+    struct Performer
+    {
+        virtual ~Performer() { }
+        virtual void performStage (int stage) = 0;
+    };
+
+    RenderSchedule();
+    ~RenderSchedule();
+
+    /** Adds a new stage and returns its index */
+    int addStage();
+
+    /** Make 'stage' wait for 'dependency' to complete before it is performed */
+    void addDependency (int dependency, int stage);
+
+    /** Prepares the runtime data.  Call this after all stages and dependencies
+        have been added and before the schedule is performed. Not realtime safe. */
+    void finalize();
+
+    /** Returns the number of stages */
+    int getNumStages() const noexcept { return numStages; }
+
+    /** Returns the number of stages on the longest dependency chain. If this
+        equals the number of stages then nothing can be rendered in parallel. */
+    int getCriticalPathLength() const noexcept { return criticalPath; }
+
+    /** Returns true if performing on a pool could be faster than serial */
+    bool canRenderInParallel() const noexcept { return numStages > 1 && criticalPath < numStages; }
+
+    /** Performs every stage on the calling thread in index order */
+    void performSerial (Performer&);
+
+private:
+    friend class RenderThreadPool;
+
+    int numStages = 0;
+    int criticalPath = 0;
+    Array<Array<int>> successors;
+    Array<int> numDependencies;
+    Array<int> roots;
+
+    std::unique_ptr<std::atomic<int>[]> pending;
+    std::unique_ptr<std::atomic<int>[]> ready;
+    std::atomic<int> readHead { 0 };
+    std::atomic<int> writeHead { 0 };
+    std::atomic<int> numRemaining { 0 };
+    Performer* performer = nullptr;
+
+    void begin (Performer&);
+    void push (int stage) noexcept;
+    int pop() noexcept;
+    void execute() noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (RenderSchedule)
+};
+
+/** A fixed pool of high priority worker threads which perform RenderSchedules
+    together with the calling (audio) thread.
+
+    Only one thread at a time may call perform().  A schedule performed on the
+    pool must not perform another schedule on the same pool from one of its
+    stages, check isPerforming() and render serially instead.
+*/
+class RenderThreadPool
+{
+public:
+    /** Create a pool with a number of worker threads.  The thread calling
+        perform() also renders, so a pool of N workers uses N + 1 cores. */
+    explicit RenderThreadPool (int numWorkers);
+    ~RenderThreadPool();
+
+    /** Returns the number of worker threads */
+    int getNumWorkers() const noexcept { return workers.size(); }
+
+    /** True while a schedule is being performed */
+    bool isPerforming() const noexcept { return performing.load (std::memory_order_acquire); }
+
+    /** Performs all stages of a finalized schedule and returns when every
+        stage has completed. */
+    void perform (RenderSchedule&, RenderSchedule::Performer&);
+
+    /** Returns a sensible number of workers for this machine */
+    static int getDefaultNumWorkers();
+
+private:
+    class Worker;
+    OwnedArray<Worker> workers;
+    std::atomic<RenderSchedule*> current { nullptr };
+    std::atomic<uint32> generation { 0 };
+    std::atomic<int> numActive { 0 };
+    std::atomic<int> numSleeping { 0 };
+    std::atomic<bool> performing { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderThreadPool)
+};
+
+}
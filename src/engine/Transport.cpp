@@ -50,8 +50,38 @@ void Transport::preProcess (int nframes)
         playing = playState.get();
     }
 
-    if (playing) {
-        
+    if (clockSyncWanted)
+    {
+        clockSyncWanted = false;
+        syncToClock (nframes);
+    }
+}
+
+void Transport::syncToClock (int nframes)
+{
+    if (std::abs (getTempo() - clockTempo) > 0.001)
+    {
+        setTempo (clockTempo);
+        nextTempo.set (getTempo());
+        monitor->tempo.set (nextTempo.get());
+    }
+
+    // jump when stopped or far off, otherwise pull the playhead toward the
+    // clock a little each block so the correction isn't audible
+    const int64 position = getPositionFrames();
+    const double error = clockFrame - (double) position;
+    if (! playing || std::abs (error) > clockFramesPerBeat * 0.25)
+    {
+        const int64 frame = jmax ((int64) 0, (int64) std::llround (clockFrame));
+        if (frame != position)
+            seekAudioFrame (frame);
+    }
+    else
+    {
+        const int maxNudge = jmax (1, nframes / 8);
+        const int nudge = jlimit (-maxNudge, maxNudge, roundToInt (error * 0.1));
+        if (nudge != 0)
+            seekAudioFrame (position + nudge);
     }
 }
 
@@ -110,4 +140,14 @@ void Transport::requestAudioFrame (const int64 frame)
     seekWanted.set (true);
 }
 
+void Transport::requestClockSync (const double bpm, const double beats, const double sampleRate)
+{
+    if (bpm <= 0.0 || sampleRate <= 0.0)
+        return;
+    clockSyncWanted     = true;
+    clockTempo          = jlimit (20.0, 999.0, bpm);
+    clockFramesPerBeat  = 60.0 * sampleRate / clockTempo;
+    clockFrame          = beats * clockFramesPerBeat;
+}
+
 }
@@ -35,6 +35,8 @@ namespace Element
                 beatsPerBar.set (4);
                 beatType.set (2);
                 beatDivisor.set (2);
+                clockLocked.set (false);
+                clockJitter.set (0.0);
             }
             
             Atomic<int>    beatsPerBar;
@@ -45,6 +47,8 @@ namespace Element
             Atomic<bool>   playing;
             Atomic<bool>   recording;
             Atomic<int64>  positionFrames;
+            Atomic<bool>   clockLocked;
+            Atomic<double> clockJitter;
             
             inline double getPositionSeconds() const
             {
@@ -86,6 +90,11 @@ namespace Element
         
         void requestAudioFrame (const int64 frame);
 
+        /** Locks tempo and playhead to an external clock for the next block.
+            Call on the audio thread before preProcess() with the clock's tempo
+            and its song position in beats at the start of the block. */
+        void requestClockSync (const double bpm, const double beats, const double sampleRate);
+
         void preProcess (int nframes);
         void postProcess (int nframes);
 
@@ -98,6 +107,12 @@ namespace Element
         
         Atomic<bool> seekWanted;
         AtomicValue<int64> seekFrame;
+
+        bool clockSyncWanted = false;
+        double clockTempo = 120.0;
+        double clockFrame = 0.0;
+        double clockFramesPerBeat = 0.0;
+        void syncToClock (int nframes);
         
         MonitorPtr monitor;
     };
@@ -156,16 +156,24 @@ AudioProcessorNode::AudioProcessorNode (uint32 nodeId, AudioProcessor* processor
     
     if (auto* instance = dynamic_cast<AudioPluginInstance*> (proc.get()))
     {
-        setAudioProcessorNodePropertiesFrom (instance->getPluginDescription(), metadata);
+        const auto desc = instance->getPluginDescription();
+        setAudioProcessorNodePropertiesFrom (desc, metadata);
+
+        // plugins report edits to the host, internal processors don't
+        setStateChangesTracked (desc.pluginFormatName != "Element" &&
+                                desc.pluginFormatName != "Internal");
     }
     else
     {
         jassertfalse; // need a way to identify normal audio processors
     }
+
+    proc->addListener (this);
 }
 
 AudioProcessorNode::~AudioProcessorNode()
 {
+    proc->removeListener (this);
     params.clear();
     enablement.cancelPendingUpdate();
     pluginState.reset();
@@ -26,7 +26,8 @@ namespace Element {
 class GraphProcessor;
 class MidiPipe;
 
-class AudioProcessorNode : public GraphNode
+class AudioProcessorNode : public GraphNode,
+                           private AudioProcessorListener
 {
 public:
     AudioProcessorNode (uint32 nodeId, AudioProcessor* processor);
@@ -52,6 +53,9 @@ private:
 
     ParameterArray params;
 
+    void audioProcessorParameterChanged (AudioProcessor*, int, float) override { markStateDirty(); }
+    void audioProcessorChanged (AudioProcessor*) override { markStateDirty(); }
+
     struct EnablementUpdater : public AsyncUpdater
     {
         EnablementUpdater (AudioProcessorNode& n) : node (n) { }
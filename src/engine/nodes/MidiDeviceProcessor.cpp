@@ -116,6 +116,11 @@ MidiDeviceProcessor::MidiDeviceProcessor (const bool isInput, MidiEngine& me)
       midi (me)
 {
     setPlayConfigDetails (0, 0, 44100.0, 1024);
+    outputScheduler.onSend = [this](const MidiMessage& message)
+    {
+        if (output != nullptr)
+            output->sendMessageNow (message);
+    };
 }
 
 MidiDeviceProcessor::~MidiDeviceProcessor() noexcept { }
@@ -179,7 +184,7 @@ void MidiDeviceProcessor::prepareToPlay (double sampleRate, int maximumExpectedS
         if (output)
         {
             output->clearAllPendingMessages();
-            output->startBackgroundThread();
+            outputScheduler.prepare (sampleRate, midi.getAudioOutputLatency());
         } 
         else
         {
@@ -201,11 +206,10 @@ void MidiDeviceProcessor::processBlock (AudioBuffer<float>& audio, MidiBuffer& m
     }
     else
     {
-        if (output && !midi.isEmpty())
+        if (output)
         {
-            const double delayMs = 6.0;
-            output->sendBlockOfMessages (
-                midi, delayMs + Time::getMillisecondCounterHiRes(), getSampleRate());
+            outputScheduler.setLookahead (this->midi.getMidiOutputLookahead());
+            outputScheduler.scheduleBlock (midi, nframes);
         }
 
         midi.clear (0, nframes);
@@ -224,11 +228,8 @@ void MidiDeviceProcessor::releaseResources()
         input = nullptr;
     }
 
-    if (output)
-    {
-        output->stopBackgroundThread();
-        output = nullptr;
-    }
+    outputScheduler.release();
+    output = nullptr;
 }
 
 AudioProcessorEditor* MidiDeviceProcessor::createEditor()
@@ -265,7 +266,7 @@ void MidiDeviceProcessor::handleIncomingMidiMessage (MidiInput* source, const Mi
 {
     if (message.isActiveSense())
         return;
-    inputMessages.addMessageToQueue (message);
+    inputMessages.addMessage (message);
 }
 
 void MidiDeviceProcessor::handlePartialSysexMessage (MidiInput* source, const uint8* messageData,
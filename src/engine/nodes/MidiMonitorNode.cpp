@@ -28,7 +28,6 @@ MidiMonitorNode::MidiMonitorNode()
     jassert (metadata.hasType (Tags::node));
     metadata.setProperty (Tags::format, "Element", nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_MIDI_MONITOR, nullptr);
-    midiTemp.ensureSize (3 * 32);
 }
 
 MidiMonitorNode::~MidiMonitorNode()
@@ -39,9 +38,7 @@ MidiMonitorNode::~MidiMonitorNode()
 
 void MidiMonitorNode::prepareToRender (double sampleRate, int maxBufferSize)
 {
-    inputMessages.reset (sampleRate);
     currentSampleRate = sampleRate;
-    numSamples = 0;
     startTimerHz (refreshRateHz);
 };
 
@@ -54,62 +51,38 @@ void MidiMonitorNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
     auto timestamp = Time::getMillisecondCounterHiRes();
     const auto nframes = audio.getNumSamples();
-
     if (nframes == 0)
         return;
 
-    auto* const midiIn = midi.getWriteBuffer (0);
+    // the timer drains these in batches, full queues drop and count
+    auto* const midiIn = midi.getReadBuffer (0);
     MidiBuffer::Iterator iter (*midiIn);
-    MidiMessage msg;
-    int frame;
+    const uint8* data = nullptr;
+    int numBytes = 0, frame = 0;
 
-    ScopedLock sl (lock);
-    while (iter.getNextEvent (msg, frame))
-    {
-        msg.setTimeStamp (timestamp + (1000.0 * (static_cast<double> (frame) / currentSampleRate)));
-        inputMessages.addMessageToQueue (msg);
-    }
-
-    numSamples += nframes;
-}
-
-void MidiMonitorNode::getMessages (MidiBuffer& destBuffer)
-{
-    ScopedLock sl (lock);
-    if (numSamples <= 0)
-        return;
-    inputMessages.removeNextBlockOfMessages (destBuffer, numSamples);
-    numSamples = 0;
+    while (iter.getNextEvent (data, numBytes, frame))
+        inputMessages.addMessage (data, numBytes, timestamp + (1000.0 * (static_cast<double> (frame) / currentSampleRate)));
 }
 
 void MidiMonitorNode::clearMessages()
 {
+    // the timer is the only consumer and runs on this thread too
+    MidiMessage msg; double time = 0.0;
+    while (inputMessages.removeNextMessage (msg, time)) { }
     midiLog.clearQuick();
     messagesLogged();
-    ScopedLock sl (lock);
-    inputMessages.reset (currentSampleRate);
-    numSamples = 0;
 }
 
 void MidiMonitorNode::timerCallback()
 {
-    midiTemp.clear();
-    getMessages (midiTemp);
-    if (midiTemp.getNumEvents() <= 0)
-        return;
-
-    MidiBuffer::Iterator iter (midiTemp);
-    MidiMessage msg; int frame = 0;
-
+    MidiMessage msg; double time = 0.0;
     int numLogged = 0;
     String text;
-    while (iter.getNextEvent (msg, frame))
+
+    while (inputMessages.removeNextMessage (msg, time))
     {
         if (msg.isMidiClock())
-        {
-            text.clear();
             continue;
-        }
 
         if (msg.isMidiStart())
             text << "Start";
@@ -123,6 +96,14 @@ void MidiMonitorNode::timerCallback()
         ++numLogged;
     }
 
+    const int numDropped = inputMessages.getNumDroppedMessages();
+    if (numDropped != numDroppedLogged)
+    {
+        midiLog.add (String (numDropped - numDroppedLogged) + " messages dropped");
+        numDroppedLogged = numDropped;
+        ++numLogged;
+    }
+
     if (midiLog.size() > maxLoggedMessages)
         midiLog.removeRange (0, midiLog.size() - maxLoggedMessages);
 
@@ -130,4 +111,4 @@ void MidiMonitorNode::timerCallback()
         messagesLogged();
 }
 
-};
+}
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include "engine/MidiInputQueue.h"
 #include "engine/MidiPipe.h"
 #include "engine/nodes/BaseProcessor.h"
 #include "engine/nodes/MidiFilterNode.h"
@@ -67,12 +68,10 @@ private:
     friend class MidiMonitorNodeEditor;
      Signal<void()> messagesLogged;
     double currentSampleRate = 44100.0;
-    int numSamples = 0;
-    MidiMessageCollector inputMessages;
+    MidiInputQueue inputMessages;
+    int numDroppedLogged = 0;
     bool createdPorts = false;
-    CriticalSection lock;
     
-    MidiBuffer  midiTemp;
     StringArray midiLog;
     int maxLoggedMessages { 100 };
     float refreshRateHz { 60.0 };
@@ -88,7 +87,6 @@ private:
         createdPorts = true;
     }
 
-    void getMessages (MidiBuffer &destBuffer);
     void timerCallback() override;
 };
 
@@ -82,35 +82,42 @@ void OSCSenderNode::getState (MemoryBlock& block)
 
 void OSCSenderNode::run ()
 {
+    MidiMessage msg;
+    double time = 0.0;
+
     while (! threadShouldExit())
     {
-        sem.wait();
+        // polled so the audio thread never has to signal
+        wait (2);
 
         if (threadShouldExit())
             break;
+        if (! midiMessageQueue.hasPendingMessages())
+            continue;
 
-        /** MIDI queue -> OSC messages */
-
-        MidiBuffer messages;
-
-        midiMessageQueue.removeNextBlockOfMessages (messages, numSamples.get());
-        numSamples = 0;
-
-        MidiBuffer::Iterator iter1 (messages);
-        MidiMessage msg;
-        int frame;
+        /** MIDI queue -> OSC bundles */
 
         ScopedLock sl (lock);
 
-        while (iter1.getNextEvent (msg, frame))
+        while (midiMessageQueue.hasPendingMessages())
         {
-            OSCMessage oscMsg = Util::processMidiToOscMessage (msg);
-            oscSender.send ( oscMsg );
+            OSCBundle bundle;
+            int numInBundle = 0;
 
-            if (! msg.isMidiClock())
+            while (numInBundle < maxBundleSize && midiMessageQueue.removeNextMessage (msg, time))
             {
-                oscMessagesToLog.push_back ( oscMsg );
+                OSCMessage oscMsg = Util::processMidiToOscMessage (msg);
+                bundle.addElement (oscMsg);
+                ++numInBundle;
+
+                if (! msg.isMidiClock())
+                {
+                    oscMessagesToLog.push_back ( oscMsg );
+                }
             }
+
+            if (numInBundle > 0)
+                oscSender.send (bundle);
         }
 
         while (oscMessagesToLog.size() > maxOscMessages)
@@ -123,11 +130,7 @@ void OSCSenderNode::run ()
 void OSCSenderNode::stop ()
 {
     if (isThreadRunning())
-    {
-        signalThreadShouldExit();
-        sem.post();
         stopThread (100);
-    }
 }
 
 /** MIDI */
@@ -143,13 +146,10 @@ inline void OSCSenderNode::createPorts()
     createdPorts = true;
 }
 
-void OSCSenderNode::prepareToRender (double sampleRate, int maxBufferSize) {
-    if (! midiMessageQueueInitDone) {
-        midiMessageQueue.reset (sampleRate);
-        currentSampleRate = sampleRate;
-        midiMessageQueueInitDone = true;
-    }
-};
+void OSCSenderNode::prepareToRender (double sampleRate, int maxBufferSize)
+{
+    currentSampleRate = sampleRate;
+}
 
 void OSCSenderNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
@@ -162,18 +162,13 @@ void OSCSenderNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
     }
 
     MidiBuffer::Iterator iter1 (*midiIn);
-    MidiMessage msg;
-    int frame;
+    const uint8* data = nullptr;
+    int numBytes = 0, frame = 0;
     auto timestamp = Time::getMillisecondCounterHiRes();
 
-    while (iter1.getNextEvent (msg, frame))
-    {
-        msg.setTimeStamp ( timestamp + (1000.0 * (static_cast<double> (frame) / currentSampleRate)) );
-        midiMessageQueue.addMessageToQueue ( msg );
-    }
+    while (iter1.getNextEvent (data, numBytes, frame))
+        midiMessageQueue.addMessage (data, numBytes, timestamp + (1000.0 * (static_cast<double> (frame) / currentSampleRate)));
 
-    numSamples += nframes;
-    sem.post();
     midiIn->clear();
 }
 
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include "engine/MidiInputQueue.h"
 #include "engine/MidiPipe.h"
 #include "engine/nodes/BaseProcessor.h"
 #include "engine/nodes/MidiFilterNode.h"
@@ -83,9 +84,11 @@ public:
 
     std::vector<OSCMessage> getOscMessages();
 
+    /** Number of MIDI messages dropped because the sender thread fell behind */
+    int getNumDroppedMessages() const { return midiMessageQueue.getNumDroppedMessages(); }
+
 private:
 
-    Semaphore sem;
     CriticalSection lock;
 
     /** MIDI */
@@ -106,12 +109,14 @@ private:
     /** GUI */
     std::vector<OSCMessage> oscMessagesToLog;
 
-    /** To be processed and sent as OSC messages */
-    MidiMessageCollector midiMessageQueue;
+    /** Max messages sent in one bundle */
+    int maxBundleSize = 64;
+
+    /** To be processed and sent as OSC messages, filled on the audio
+        thread and drained in batches by the sender thread */
+    MidiInputQueue midiMessageQueue;
 
-    Atomic<int> numSamples = 0;
-    double currentSampleRate = 0;
-    bool midiMessageQueueInitDone = false;
+    double currentSampleRate = 44100.0;
 };
 
 }
@@ -237,7 +237,7 @@ void BlockComponent::mouseDown (const MouseEvent& e)
     {
         node.setProperty (Tags::collapsed, !collapsed);
         update (false);
-        getGraphPanel()->updateConnectorComponents();
+        getGraphPanel()->updateConnectorComponents (filterID);
         collapsedToggled = true;
         blockDrag = true;
     }
@@ -351,7 +351,7 @@ void BlockComponent::updatePosition()
     node.getRelativePosition (relativeX, relativeY);
     vertical ? setCentreRelative (relativeX, relativeY)
              : setCentreRelative (relativeY, relativeX);
-    getGraphPanel()->updateConnectorComponents();
+    getGraphPanel()->updateConnectorComponents (filterID);
 }
 
 void BlockComponent::makeEditorActive()
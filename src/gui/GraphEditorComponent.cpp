@@ -381,7 +381,7 @@ GraphEditorComponent::~GraphEditorComponent()
     data = ValueTree();
     draggingConnector = nullptr;
     resizePositionsFrozen = false;
-    deleteAllChildren();
+    clearComponents();
 
     factory.reset();
 }
@@ -400,7 +400,7 @@ void GraphEditorComponent::setNode (const Node& n)
 
     if (draggingConnector)
         removeChildComponent (draggingConnector.get());
-    deleteAllChildren();
+    clearComponents();
     updateComponents();
     if (draggingConnector)
         addAndMakeVisible (draggingConnector.get());
@@ -418,7 +418,7 @@ void GraphEditorComponent::setVerticalLayout (const bool isVertical)
         graph.setProperty ("vertical", verticalLayout);
     
     draggingConnector = nullptr;
-    deleteAllChildren();
+    clearComponents();
     updateComponents();
 }
 
@@ -609,26 +609,31 @@ void GraphEditorComponent::createNewPlugin (const PluginDescription* desc, int x
 
 BlockComponent* GraphEditorComponent::getComponentForFilter (const uint32 filterID) const
 {
-    for (int i = getNumChildComponents(); --i >= 0;)
-    {
-        if (BlockComponent* const fc = dynamic_cast <BlockComponent*> (getChildComponent (i)))
-            if (fc->filterID == filterID)
-                return fc;
-    }
-
-    return nullptr;
+    return blocks[(int) filterID].getComponent();
 }
 
-ConnectorComponent* GraphEditorComponent::getComponentForConnection (const Arc& arc) const
+ConnectorComponent* GraphEditorComponent::getComponentForConnection (const Arc& arc)
 {
-    for (int i = getNumChildComponents(); --i >= 0;)
+    if (! connectors.contains ((int) arc.sourceNode))
+        return nullptr;
+
+    auto& attached = connectors.getReference ((int) arc.sourceNode);
+    for (int i = attached.size(); --i >= 0;)
     {
-        if (ConnectorComponent* const c = dynamic_cast <ConnectorComponent*> (getChildComponent (i)))
-            if (c->sourceFilterID == arc.sourceNode
-                 && c->destFilterID == arc.destNode
-                 && c->sourceFilterChannel == arc.sourcePort
-                 && c->destFilterChannel == arc.destPort)
-                return c;
+        ConnectorComponent* const c = attached.getReference (i).getComponent();
+        if (c == nullptr)
+        {
+            attached.remove (i);
+            continue;
+        }
+
+        // the dragged connector no longer represents an arc
+        if (c != draggingConnector.get()
+             && c->sourceFilterID == arc.sourceNode
+             && c->destFilterID == arc.destNode
+             && c->sourceFilterChannel == (int) arc.sourcePort
+             && c->destFilterChannel == (int) arc.destPort)
+            return c;
     }
 
     return nullptr;
@@ -663,57 +668,94 @@ void GraphEditorComponent::changeListenerCallback (ChangeBroadcaster*)
 void GraphEditorComponent::updateConnectorComponents()
 {
     const ValueTree arcs = graph.getArcsValueTree();
-    for (int i = getNumChildComponents(); --i >= 0;)
+    Array<ConnectorComponent*> remaining;
+
+    for (HashMap<int, Array<ConnectorPtr>>::Iterator iter (connectors); iter.next();)
     {
-        ConnectorComponent* const cc = dynamic_cast <ConnectorComponent*> (getChildComponent (i));
-        if (cc != nullptr && cc != draggingConnector.get())
+        for (const auto& ptr : iter.getValue())
         {
-            if (! Node::connectionExists (arcs, cc->sourceFilterID, (uint32) cc->sourceFilterChannel, 
-                                                cc->destFilterID, (uint32) cc->destFilterChannel,
-                                                true))
-            {
-                delete cc;
-            }
-            else
-            {
+            // each connector is listed under both of its nodes, visit it once
+            ConnectorComponent* const cc = ptr.getComponent();
+            if (cc != nullptr && cc != draggingConnector.get() && (int) cc->sourceFilterID == iter.getKey())
+                remaining.add (cc);
+        }
+    }
+
+    connectors.clear();
+    for (auto* cc : remaining)
+    {
+        if (! Node::connectionExists (arcs, cc->sourceFilterID, (uint32) cc->sourceFilterChannel, 
+                                            cc->destFilterID, (uint32) cc->destFilterChannel,
+                                            true))
+        {
+            delete cc;
+        }
+        else
+        {
+            attachConnector (cc->sourceFilterID, cc);
+            if (cc->destFilterID != cc->sourceFilterID)
+                attachConnector (cc->destFilterID, cc);
+            cc->update();
+        }
+    }
+}
+
+void GraphEditorComponent::updateConnectorComponents (const uint32 nodeId)
+{
+    if (! connectors.contains ((int) nodeId))
+        return;
+
+    auto& attached = connectors.getReference ((int) nodeId);
+    for (int i = attached.size(); --i >= 0;)
+    {
+        if (ConnectorComponent* const cc = attached.getReference (i).getComponent())
+        {
+            if (cc != draggingConnector.get())
                 cc->update();
-            }
+        }
+        else
+        {
+            attached.remove (i);
         }
     }
 }
 
 void GraphEditorComponent::updateBlockComponents (const bool doPosition)
 {
-    for (int i = getNumChildComponents(); --i >= 0;)
-        if (auto* const fc = dynamic_cast<BlockComponent*> (getChildComponent (i)))
+    Array<BlockPtr> toUpdate;
+    for (HashMap<int, BlockPtr>::Iterator iter (blocks); iter.next();)
+        toUpdate.add (iter.getValue());
+
+    // blocks of removed nodes delete themselves when updated
+    for (auto& block : toUpdate)
+        if (auto* const fc = block.getComponent())
             { fc->update (doPosition); }
 }
 
 void GraphEditorComponent::stabilizeNodes()
 {
-    for (int i = getNumChildComponents(); --i >= 0;)
-        if (auto* const fc = dynamic_cast<BlockComponent*> (getChildComponent (i)))
+    for (HashMap<int, BlockPtr>::Iterator iter (blocks); iter.next();)
+        if (auto* const fc = iter.getValue().getComponent())
             { fc->update (false); fc->repaint(); }
 }
 
-void GraphEditorComponent::updateComponents()
+void GraphEditorComponent::createMissingConnectors()
 {
     for (int i = graph.getNumConnections(); --i >= 0;)
     {
         const ValueTree c = graph.getConnectionValueTree (i);
+        if ((bool) c.getProperty (Tags::missing, false))
+            continue;
+
         const Arc arc (Node::arcFromValueTree (c));
-        ConnectorComponent* connector = getComponentForConnection (arc);
-        
-        if (connector == nullptr)
-        {
-            connector = new ConnectorComponent (graph);
-            addAndMakeVisible (connector, i);
-        }
-        
-        connector->setGraph (this->graph);
-        connector->setInput (arc.sourceNode, arc.sourcePort);
-        connector->setOutput (arc.destNode, arc.destPort);
+        if (getComponentForConnection (arc) == nullptr)
+            createConnector (arc, i);
     }
+}
+
+void GraphEditorComponent::updateComponents()
+{
+    createMissingConnectors();
     
     for (int i = graph.getNumNodes(); --i >= 0;)
     {
@@ -731,6 +773,13 @@ void GraphEditorComponent::updateComponents()
     updateConnectorComponents();
 }
 
+void GraphEditorComponent::clearComponents()
+{
+    deleteAllChildren();
+    blocks.clear();
+    connectors.clear();
+}
+
 void GraphEditorComponent::beginConnectorDrag (const uint32 sourceNode, const int sourceFilterChannel,
                                                const uint32 destNode, const int destFilterChannel,
                                                const MouseEvent& e)
@@ -974,7 +1023,8 @@ void GraphEditorComponent::itemDropped (const SourceDetails& details)
 
 void GraphEditorComponent::valueTreeChildAdded (ValueTree& parent, ValueTree& child)
 {
-    if (child.hasType (Tags::node))
+    // the graph's children and their ports, nested graphs are ignored
+    if (parent == graph.getNodesValueTree() && child.hasType (Tags::node))
     {
         child.setProperty ("relativeX", verticalLayout ? lastDropX : lastDropY, 0);
         child.setProperty ("relativeY", verticalLayout ? lastDropY : lastDropX, 0);
@@ -982,18 +1032,46 @@ void GraphEditorComponent::valueTreeChildAdded (ValueTree& parent, ValueTree& ch
         addAndMakeVisible (comp, 20000);
         comp->update();
     }
-    else if (child.hasType (Tags::arc) || child.hasType (Tags::nodes) ||
-             child.hasType (Tags::arcs))
+    else if (parent == graph.getArcsValueTree() && child.hasType (Tags::arc))
+    {
+        const Arc arc (Node::arcFromValueTree (child));
+        if (! (bool) child.getProperty (Tags::missing, false) && getComponentForConnection (arc) == nullptr)
+            createConnector (arc, 0);
+    }
+    else if (parent == data && child.hasType (Tags::arcs))
+    {
+        // the engine replaces all arcs when connections change
+        createMissingConnectors();
+        updateConnectorComponents();
+    }
+    else if (parent == data && child.hasType (Tags::nodes))
     {
         updateComponents();
     }
-    else if (child.hasType (Tags::ports))
+    else if (child.hasType (Tags::ports) && parent.getParent() == graph.getNodesValueTree())
     {
         const Node node (parent, false);
-        for (int i = 0; i < getNumChildComponents(); ++i)
-            if (auto* const filter = dynamic_cast<BlockComponent*> (getChildComponent (i)))
-                filter->update();
-        updateConnectorComponents();
+        if (auto* const filter = getComponentForFilter (node.getNodeId()))
+            filter->update();
+        updateConnectorComponents (node.getNodeId());
+    }
+}
+
+void GraphEditorComponent::valueTreeChildRemoved (ValueTree& parent, ValueTree& child, int)
+{
+    if (parent == graph.getNodesValueTree() && child.hasType (Tags::node))
+    {
+        const Node node (child, false);
+        if (auto* const block = getComponentForFilter (node.getNodeId()))
+        {
+            blocks.remove ((int) node.getNodeId());
+            delete block;
+        }
+    }
+    else if (parent == graph.getArcsValueTree() && child.hasType (Tags::arc))
+    {
+        if (auto* const connector = getComponentForConnection (Node::arcFromValueTree (child)))
+            delete connector;
     }
 }
 
@@ -1036,9 +1114,14 @@ void GraphEditorComponent::deleteSelectedNodes()
 
 void GraphEditorComponent::updateSelection()
 {
-    for (int i = getNumChildComponents(); --i >= 0;)
+    Array<BlockPtr> toRepaint;
+    for (HashMap<int, BlockPtr>::Iterator iter (blocks); iter.next();)
+        toRepaint.add (iter.getValue());
+
+    // the dispatch loop may add or remove blocks
+    for (auto& ptr : toRepaint)
     {
-        if (auto* const block = dynamic_cast <BlockComponent*> (getChildComponent (i)))
+        if (auto* const block = ptr.getComponent())
         { 
             block->repaint();
             MessageManager::getInstance()->runDispatchLoopUntil (20);
@@ -1049,9 +1132,33 @@ void GraphEditorComponent::updateSelection()
 BlockComponent* GraphEditorComponent::createBlock (const Node& node)
 {
     if (auto* cc = ViewHelpers::findContentComponent (this))
-        return factory->createBlockComponent (cc->getAppController(), node);
+    {
+        auto* const block = factory->createBlockComponent (cc->getAppController(), node);
+        blocks.set ((int) node.getNodeId(), block);
+        return block;
+    }
+
     jassertfalse;
     return nullptr;
 }
 
+ConnectorComponent* GraphEditorComponent::createConnector (const Arc& arc, const int zOrder)
+{
+    auto* const connector = new ConnectorComponent (graph);
+    addAndMakeVisible (connector, zOrder);
+    connector->setInput (arc.sourceNode, arc.sourcePort);
+    connector->setOutput (arc.destNode, arc.destPort);
+    attachConnector (arc.sourceNode, connector);
+    if (arc.destNode != arc.sourceNode)
+        attachConnector (arc.destNode, connector);
+    return connector;
+}
+
+void GraphEditorComponent::attachConnector (const uint32 nodeId, ConnectorComponent* connector)
+{
+    if (! connectors.contains ((int) nodeId))
+        connectors.set ((int) nodeId, Array<ConnectorPtr>());
+    connectors.getReference ((int) nodeId).add (connector);
+}
+
 }
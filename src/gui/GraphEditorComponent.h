@@ -110,6 +110,12 @@ private:
     SelectedItemSet<uint32> selectedNodes;
     bool ignoreNodeSelected = false;
 
+    // blocks by node id, connectors by the id of each node they attach to
+    typedef Component::SafePointer<BlockComponent> BlockPtr;
+    typedef Component::SafePointer<ConnectorComponent> ConnectorPtr;
+    HashMap<int, BlockPtr> blocks;
+    HashMap<int, Array<ConnectorPtr>> connectors;
+
     void selectNode (const Node& node, ModifierKeys mods);
 
     Component* createContainerForNode (GraphNodePtr node, bool useGenericEditor);
@@ -118,6 +124,9 @@ private:
     
     void updateBlockComponents (const bool doPosition = true);
     void updateConnectorComponents();
+    void updateConnectorComponents (const uint32 nodeId);
+    void createMissingConnectors();
+    void clearComponents();
     
     void beginConnectorDrag (const uint32 sourceFilterID, const int sourceFilterChannel,
                              const uint32 destFilterID, const int destFilterChannel,
@@ -126,9 +135,11 @@ private:
     void endDraggingConnector (const MouseEvent& e);
     
     BlockComponent* createBlock (const Node&);
+    ConnectorComponent* createConnector (const Arc& arc, const int zOrder);
+    void attachConnector (const uint32 nodeId, ConnectorComponent* connector);
 
     BlockComponent* getComponentForFilter (const uint32 filterID) const;
-    ConnectorComponent* getComponentForConnection (const Arc& conn) const;
+    ConnectorComponent* getComponentForConnection (const Arc& conn);
     PortComponent* findPinAt (const int x, const int y) const;
     
     void updateSelection();
@@ -136,7 +147,7 @@ private:
     void valueTreePropertyChanged (ValueTree& treeWhosePropertyHasChanged, const Identifier& property) override { }
     void valueTreeChildAdded (ValueTree& parentTree, ValueTree& childWhichHasBeenAdded) override;
     void valueTreeChildRemoved (ValueTree& parentTree, ValueTree& childWhichHasBeenRemoved,
-                                                       int indexFromWhichChildWasRemoved) override { }
+                                                       int indexFromWhichChildWasRemoved) override;
     void valueTreeChildOrderChanged (ValueTree& parentTreeWhoseChildrenHaveMoved,
                                              int oldIndex, int newIndex) override { }
     void valueTreeParentChanged (ValueTree& treeWhoseParentHasChanged) override { }
@@ -60,6 +60,7 @@ public:
 
     ~NodeChannelStripComponent()
     {
+        setMeteredNode (nullptr);
         unbindSignals();
     }
 
@@ -157,6 +158,7 @@ public:
         }
         else
         {
+            setMeteredNode (nullptr);
             meter.resetPeaks();
             stopTimer();
         }
@@ -204,6 +206,7 @@ public:
         node.getPorts (audioIns, audioOuts, PortType::Audio);
         displayName.referTo (node.getPropertyAsValue (Tags::name));
         stabilizeContent();
+        setMeteredNode (node.getGraphNode());
         startTimerHz (meterSpeedHz);
 
         if (onNodeChanged)
@@ -266,6 +269,7 @@ private:
     bool monoMeter      = false;
 
     Value displayName;
+    GraphNodePtr meteredNode;
 
     SignalConnection nodeSelectedConnection;
     SignalConnection volumeChangedConnection;
@@ -273,6 +277,17 @@ private:
     SignalConnection volumeDoubleClickedConnection;
     SignalConnection muteChangedConnection;
 
+    void setMeteredNode (GraphNode* newNode)
+    {
+        if (meteredNode.get() == newNode)
+            return;
+        if (meteredNode != nullptr)
+            meteredNode->stopMetering();
+        meteredNode = newNode;
+        if (meteredNode != nullptr)
+            meteredNode->startMetering();
+    }
+
     inline bool isMonitoringInputs() const  { return flowBox.getSelectedId() == 1; }
     inline bool isMonitoringOutputs() const { return flowBox.getSelectedId() == 2; }
 
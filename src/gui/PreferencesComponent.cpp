@@ -664,6 +664,20 @@ namespace Element {
             addAndMakeVisible (midiOutput);
             midiOutput.addListener (this);
 
+            addAndMakeVisible (outputLookaheadLabel);
+            outputLookaheadLabel.setFont (Font (12.0, Font::bold));
+            outputLookaheadLabel.setText ("MIDI Output Lookahead (ms)", dontSendNotification);
+            addAndMakeVisible (outputLookahead);
+            outputLookahead.setRange (-100.0, 100.0, 0.1);
+            outputLookahead.setValue (settings.getMidiOutputLookahead(), dontSendNotification);
+            outputLookahead.setSliderStyle (Slider::IncDecButtons);
+            outputLookahead.setTextBoxStyle (Slider::TextBoxLeft, false, 82, 22);
+            outputLookahead.onValueChange = [this]()
+            {
+                settings.setMidiOutputLookahead (outputLookahead.getValue());
+                midi.setMidiOutputLookahead (outputLookahead.getValue());
+            };
+
            #if defined (EL_PRO)
             addAndMakeVisible (generateClockLabel);
             generateClockLabel.setFont (Font (12.0, Font::bold));
@@ -724,6 +738,7 @@ namespace Element {
             auto r2 = r.removeFromTop (settingHeight);
             midiOutputLabel.setBounds (r2.removeFromLeft (getWidth() / 2));
             midiOutput.setBounds (r2.withSizeKeepingCentre (r2.getWidth(), settingHeight));
+            layoutSetting (r, outputLookaheadLabel, outputLookahead, getWidth() / 4);
            #if defined (EL_PRO)
             layoutSetting (r, generateClockLabel, generateClock);
             layoutSetting (r, sendClockToInputLabel, sendClockToInput);
@@ -776,6 +791,8 @@ namespace Element {
 
         Label midiOutputLabel;
         ComboBox midiOutput;
+        Label outputLookaheadLabel;
+        Slider outputLookahead;
         Label generateClockLabel;
         SettingButton generateClock;
         Label sendClockToInputLabel;
@@ -90,7 +90,7 @@ public:
                 {
                     if (isPositiveAndBelow (ptr->getMidiProgram(), 128))
                     {
-                        node.savePluginState();
+                        node.savePluginState (true);
                         node.writeToFile (ptr->getMidiProgramFile());
                     }
                 }
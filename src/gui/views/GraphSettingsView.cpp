@@ -138,6 +138,58 @@ namespace Element {
         int index;
     };
 
+    class MidiCoalescingPropertyComponent : public BooleanPropertyComponent
+    {
+    public:
+        MidiCoalescingPropertyComponent (const Node& g)
+            : BooleanPropertyComponent ("Coalesce MIDI", "Remove redundant expression"),
+              graph (g) { }
+
+        inline bool getState() const override
+        {
+            return (bool) graph.getProperty (Tags::midiCoalescing, false);
+        }
+
+        inline void setState (const bool newState) override
+        {
+            graph.setProperty (Tags::midiCoalescing, newState);
+
+            if (auto* obj = graph.getGraphNode())
+                if (auto* proc = dynamic_cast<RootGraph*> (obj->getAudioProcessor()))
+                    proc->setMidiCoalescing (newState);
+            refresh();
+        }
+
+    private:
+        Node graph;
+    };
+
+    class SubBlockSplittingPropertyComponent : public BooleanPropertyComponent
+    {
+    public:
+        SubBlockSplittingPropertyComponent (const Node& g)
+            : BooleanPropertyComponent ("Split at MIDI", "Render from each event's offset"),
+              graph (g) { }
+
+        inline bool getState() const override
+        {
+            return (bool) graph.getProperty (Tags::subBlockSplitting, false);
+        }
+
+        inline void setState (const bool newState) override
+        {
+            graph.setProperty (Tags::subBlockSplitting, newState);
+
+            if (auto* obj = graph.getGraphNode())
+                if (auto* proc = dynamic_cast<RootGraph*> (obj->getAudioProcessor()))
+                    proc->setSubBlockSplitting (newState);
+            refresh();
+        }
+
+    private:
+        Node graph;
+    };
+
     class RootGraphMidiChannels : public MidiMultiChannelPropertyComponent
     {
     public:
@@ -306,6 +358,8 @@ namespace Element {
            #if defined (EL_PRO)
             props.add (new RenderModePropertyComponent (g));
             props.add (new VelocityCurvePropertyComponent (g));
+            props.add (new MidiCoalescingPropertyComponent (g));
+            props.add (new SubBlockSplittingPropertyComponent (g));
            #endif
 
            #if defined (EL_SOLO) || defined (EL_PRO)
@@ -240,7 +240,7 @@ static void openModel (sol::state& lua)
             return copy.toXmlString().toStdString();
         },
         "resetports",           &Node::resetPorts,
-        "savestate",            &Node::savePluginState,
+        "savestate",            [](Node* self) { self->savePluginState (true); },
         "restoretate",          &Node::restorePluginState,
         "writefile", [](const Node& node, const char* filepath) -> bool {
             if (! File::isAbsolutePath (filepath))
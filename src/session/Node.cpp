@@ -19,6 +19,7 @@
 
 #include "session/Node.h"
 #include "session/Session.h"
+#include "session/SessionFile.h"
 #include "controllers/GraphManager.h"
 #include "ScopedFlag.h"
 
@@ -35,6 +36,192 @@ struct NameSorter
     friend class NodeArray;
 };
 
+//=============================================================================
+/** Maps node ids, uuids and arcs of one graph to their ValueTrees.
+
+    The index lives in a runtime property of the graph and listens to its
+    nodes and arcs. Adding and removing children updates it in place, other
+    changes mark it dirty so it gets rebuilt on the next lookup. If the nodes
+    or arcs child is replaced, the index follows the new one.
+*/
+class NodeLookupIndex : public ReferenceCountedObject,
+                        private ValueTree::Listener
+{
+public:
+    NodeLookupIndex() { }
+    ~NodeLookupIndex()
+    {
+        nodes.removeListener (this);
+        arcs.removeListener (this);
+    }
+
+    /** Returns the index of a graph, or nullptr if it doesn't have one */
+    static NodeLookupIndex* get (const ValueTree& graph)
+    {
+        auto* index = dynamic_cast<NodeLookupIndex*> (graph.getProperty (Tags::lookupIndex).getObject());
+        if (index != nullptr)
+            index->follow (graph.getChildWithName (Tags::nodes),
+                           graph.getChildWithName (Tags::arcs));
+        return index;
+    }
+
+    ValueTree findNode (const uint32 nodeId)
+    {
+        update();
+        return ids [static_cast<int64> (nodeId)];
+    }
+
+    ValueTree findNode (const String& uuid)
+    {
+        update();
+        return uuids [uuid];
+    }
+
+    ValueTree findArc (const uint32 sourceNode, const uint32 sourcePort,
+                       const uint32 destNode, const uint32 destPort)
+    {
+        update();
+        if (! arcsByNodes.contains (arcKey (sourceNode, destNode)))
+            return ValueTree();
+
+        const auto& candidates = arcsByNodes.getReference (arcKey (sourceNode, destNode));
+        for (int i = candidates.size(); --i >= 0;)
+        {
+            const ValueTree& arc = candidates.getReference (i);
+            if (static_cast<int> (sourcePort) == (int) arc.getProperty (Tags::sourcePort) &&
+                static_cast<int> (destPort) == (int) arc.getProperty (Tags::destPort))
+                return arc;
+        }
+
+        return ValueTree();
+    }
+
+    bool isIndexing (const ValueTree& tree) const { return tree == arcs || tree == nodes; }
+
+private:
+    ValueTree nodes, arcs;
+    HashMap<int64, ValueTree> ids;
+    HashMap<String, ValueTree> uuids;
+    HashMap<int64, Array<ValueTree>> arcsByNodes;
+    bool dirty = true;
+
+    static int64 arcKey (const uint32 sourceNode, const uint32 destNode) noexcept
+    {
+        return (static_cast<int64> (sourceNode) << 32) | static_cast<int64> (destNode);
+    }
+
+    static int64 arcKey (const ValueTree& arc)
+    {
+        return arcKey ((uint32)(int) arc.getProperty (Tags::sourceNode),
+                       (uint32)(int) arc.getProperty (Tags::destNode));
+    }
+
+    void follow (const ValueTree& newNodes, const ValueTree& newArcs)
+    {
+        if (newNodes != nodes)
+        {
+            nodes.removeListener (this);
+            nodes = newNodes;
+            nodes.addListener (this);
+            dirty = true;
+        }
+
+        if (newArcs != arcs)
+        {
+            arcs.removeListener (this);
+            arcs = newArcs;
+            arcs.addListener (this);
+            dirty = true;
+        }
+    }
+
+    void update()
+    {
+        if (! dirty)
+            return;
+
+        ids.clear();
+        uuids.clear();
+        arcsByNodes.clear();
+        for (int i = 0; i < nodes.getNumChildren(); ++i)
+            addNode (nodes.getChild (i));
+        for (int i = 0; i < arcs.getNumChildren(); ++i)
+            addArc (arcs.getChild (i));
+        dirty = false;
+    }
+
+    void addNode (const ValueTree& node)
+    {
+        // first one wins like getChildWithProperty
+        if (node.hasProperty (Tags::id))
+        {
+            const auto nodeId = (int64) node.getProperty (Tags::id);
+            if (! ids.contains (nodeId))
+                ids.set (nodeId, node);
+        }
+
+        const auto uuid = node.getProperty (Tags::uuid).toString();
+        if (uuid.isNotEmpty() && ! uuids.contains (uuid))
+            uuids.set (uuid, node);
+    }
+
+    void addArc (const ValueTree& arc)
+    {
+        const auto key = arcKey (arc);
+        if (! arcsByNodes.contains (key))
+            arcsByNodes.set (key, Array<ValueTree>());
+        arcsByNodes.getReference (key).add (arc);
+    }
+
+    void removeArc (const ValueTree& arc)
+    {
+        const auto key = arcKey (arc);
+        if (! arcsByNodes.contains (key))
+            return;
+
+        auto& candidates = arcsByNodes.getReference (key);
+        candidates.removeAllInstancesOf (arc);
+        if (candidates.isEmpty())
+            arcsByNodes.remove (key);
+    }
+
+    void valueTreeChildAdded (ValueTree& parent, ValueTree& child) override
+    {
+        if (dirty)
+            return;
+        if (parent == nodes)
+            addNode (child);
+        else if (parent == arcs)
+            addArc (child);
+    }
+
+    void valueTreeChildRemoved (ValueTree& parent, ValueTree& child, int) override
+    {
+        if (dirty)
+            return;
+        if (parent == arcs)
+            removeArc (child);
+        else if (parent == nodes)
+            dirty = true; // a duplicate id or uuid may have been hidden by it
+    }
+
+    void valueTreePropertyChanged (ValueTree& tree, const Identifier& property) override
+    {
+        const ValueTree parent (tree.getParent());
+        if (parent == nodes)
+            dirty = dirty || property == Tags::id || property == Tags::uuid;
+        else if (parent == arcs)
+            dirty = dirty || property == Tags::sourceNode || property == Tags::sourcePort ||
+                             property == Tags::destNode   || property == Tags::destPort;
+    }
+
+    void valueTreeChildOrderChanged (ValueTree&, int, int) override { }
+    void valueTreeParentChanged (ValueTree&) override { }
+    void valueTreeRedirected (ValueTree&) override { dirty = true; }
+
+    JUCE_DECLARE_NON_COPYABLE (NodeLookupIndex)
+};
+
 static void readPluginDescriptionForLoading (const ValueTree& p, PluginDescription& pd)
 {
     const auto& type = p.getProperty (Tags::type);
@@ -263,6 +450,16 @@ void Node::sanitizeProperties (ValueTree node, const bool recursive)
 {
     node.removeProperty (Tags::updater, nullptr);
     node.removeProperty (Tags::object,  nullptr);
+    node.removeProperty (Tags::lookupIndex, nullptr);
+
+    if (auto* chunk = SessionFile::getChunk (node))
+    {
+        // a state that was never decoded has to be kept
+        MemoryBlock state;
+        if (! node.hasProperty (Tags::state) && chunk->decode (state))
+            node.setProperty (Tags::state, state, nullptr);
+        node.removeProperty (Tags::stateChunk, nullptr);
+    }
     
     if (node.hasType (Tags::node))
     {
@@ -307,7 +504,7 @@ bool Node::savePresetTo (const DataPath& path, const String& name) const
 {
     {
         // hack: ensure the plugin's state info is up-to-date
-        Node(*this).savePluginState();
+        Node(*this).savePluginState (true);
     }
     
     ValueTree preset (Tags::preset);
@@ -527,6 +724,15 @@ bool Node::connectionExists (const ValueTree& arcs,
                                 const uint32 destNode, const uint32 destPort,
                                 const bool checkMissing)
 {
+    auto* index = NodeLookupIndex::get (arcs.getParent());
+    if (index != nullptr && index->isIndexing (arcs))
+    {
+        const ValueTree arc (index->findArc (sourceNode, sourcePort, destNode, destPort));
+        if (! arc.isValid())
+            return false;
+        return (checkMissing) ? !arc.getProperty (Tags::missing, false) : true;
+    }
+
     for (int i = arcs.getNumChildren(); --i >= 0;)
     {
         const ValueTree arc (arcs.getChild (i));
@@ -544,6 +750,9 @@ bool Node::connectionExists (const ValueTree& arcs,
 
 Node Node::getNodeById (const uint32 nodeId) const
 {
+    if (auto* index = NodeLookupIndex::get (objectData))
+        return Node (index->findNode (nodeId), false);
+
     const ValueTree nodes = getNodesValueTree();
     Node node (nodes.getChildWithProperty (Tags::id, static_cast<int64> (nodeId)), false);
     return node;
@@ -551,16 +760,9 @@ Node Node::getNodeById (const uint32 nodeId) const
 
 static Node findNodeRecursive (const Node& node, const Uuid& uuid)
 {
-    Node found;
-    for (int i = node.getNumNodes(); --i >= 0;)
-    {
-        found = node.getNode (i);
-        if (found.getUuid() == uuid)
-            return found;
-        found = findNodeRecursive (found, uuid);
-        if (found.isValid())
-            break;
-    }
+    Node found (node.getNodeByUuid (uuid, false));
+    for (int i = node.getNumNodes(); --i >= 0 && ! found.isValid();)
+        found = findNodeRecursive (node.getNode (i), uuid);
     return found;
 }
 
@@ -568,6 +770,9 @@ Node Node::getNodeByUuid (const Uuid& uuid, const bool recursive) const
 {
     if (! recursive)
     {
+        if (auto* index = NodeLookupIndex::get (objectData))
+            return Node (index->findNode (uuid.toString()), false);
+
         const ValueTree nodes = getNodesValueTree();
         Node node (nodes.getChildWithProperty (Tags::uuid, uuid.toString()), false);
         return node;
@@ -576,6 +781,12 @@ Node Node::getNodeByUuid (const Uuid& uuid, const bool recursive) const
     return findNodeRecursive (*this, uuid);
 }
 
+void Node::attachLookupIndex()
+{
+    if (NodeLookupIndex::get (objectData) == nullptr)
+        objectData.setProperty (Tags::lookupIndex, new NodeLookupIndex(), nullptr);
+}
+
 Port Node::getPort (const int index) const
 {
     Port port (getPortsValueTree().getChildWithProperty (Tags::index, index));
@@ -632,117 +843,147 @@ void Node::restorePluginState()
 {
     if (! isValid())
         return;
-    
-    if (GraphNodePtr obj = getGraphNode())
+
+    PluginStateRestorer (*this).restore();
+    restoreNodeProperties();
+
+    // this was originally here to help reduce memory usage
+    // need another way to free this property without disturbing
+    // the normal flow of the app.
+    const bool clearStateProperty = false;
+    if (clearStateProperty)
+        objectData.removeProperty (Tags::state, 0);
+
+    for (int i = 0; i < getNumNodes(); ++i)
+        getNode(i).restorePluginState();
+}
+
+/** Decodes a state property, or the session file chunk that stands in for it */
+static bool decodePluginState (const var& data, const var& chunkData, MemoryBlock& state)
+{
+    state.reset();
+    if (auto* block = data.getBinaryData())
+        state = *block;
+    else if (data.isString())
+        state.fromBase64Encoding (data.toString().trim());
+    else if (auto* chunk = dynamic_cast<SessionFile::Chunk*> (chunkData.getObject()))
+        chunk->decode (state);
+
+    return state.getSize() > 0;
+}
+
+Node::PluginStateRestorer::PluginStateRestorer (const Node& node)
+    : object (node.getGraphNode()),
+      program (node.getProperty (Tags::program, -1)),
+      state (node.getProperty (Tags::state)),
+      stateChunk (node.getProperty (Tags::stateChunk)),
+      programState (node.getProperty (Tags::programState).toString().trim())
+{ }
+
+void Node::PluginStateRestorer::restore()
+{
+    if (object == nullptr)
+        return;
+
+    MemoryBlock block;
+    decodePluginState (state, stateChunk, block);
+
+    if (auto* const proc = object->getAudioProcessor())
     {
-        if (auto* const proc = obj->getAudioProcessor())
-        {
-            const int wantedProgram = objectData.getProperty (Tags::program, -1);
-            const bool shouldSetProgram = proc->getNumPrograms() > 0 && 
-                isPositiveAndBelow (wantedProgram, proc->getNumPrograms());
-            if (shouldSetProgram)
-                proc->setCurrentProgram (wantedProgram);
-
-            auto data = getProperty(Tags::state).toString().trim();
-            if (data.isNotEmpty())
-            {
-                MemoryBlock state;
-                state.fromBase64Encoding (data);
-                if (state.getSize() > 0)
-                {
-                    proc->setStateInformation (state.getData(), (int) state.getSize());
-                }
-            }
-            
-            data = getProperty(Tags::programState).toString().trim();
-            if (shouldSetProgram && data.isNotEmpty())
-            {
-                MemoryBlock state; state.fromBase64Encoding (data);
-                if (state.getSize() > 0)
-                {
-                    proc->setCurrentProgramStateInformation (state.getData(),
-                        (int) state.getSize());
-                }
-            }
-        }
-        else
+        const bool shouldSetProgram = proc->getNumPrograms() > 0 && 
+            isPositiveAndBelow (program, proc->getNumPrograms());
+        if (shouldSetProgram)
+            proc->setCurrentProgram (program);
+
+        if (block.getSize() > 0)
+            proc->setStateInformation (block.getData(), (int) block.getSize());
+
+        if (shouldSetProgram && programState.isNotEmpty())
         {
-            const int wantedProgram = objectData.getProperty (Tags::program, -1);
-            const bool shouldSetProgram = obj->getNumPrograms() > 0 && 
-                isPositiveAndBelow (wantedProgram, obj->getNumPrograms());
-            if (shouldSetProgram)
-                obj->setCurrentProgram (wantedProgram);
-
-            auto data = getProperty(Tags::state).toString().trim();
-            if (data.isNotEmpty())
+            block.fromBase64Encoding (programState);
+            if (block.getSize() > 0)
             {
-                MemoryBlock state;
-                state.fromBase64Encoding (data);
-                if (state.getSize() > 0)
-                    obj->setState (state.getData(), (int) state.getSize());
+                proc->setCurrentProgramStateInformation (block.getData(),
+                    (int) block.getSize());
             }
         }
+    }
+    else
+    {
+        const bool shouldSetProgram = object->getNumPrograms() > 0 && 
+            isPositiveAndBelow (program, object->getNumPrograms());
+        if (shouldSetProgram)
+            object->setCurrentProgram (program);
 
-        if (hasProperty (Tags::bypass))
-        {
-            obj->suspendProcessing (isBypassed());
-        }
+        if (block.getSize() > 0)
+            object->setState (block.getData(), (int) block.getSize());
+    }
 
-        if (hasProperty (Tags::gain))
-        {
-            obj->setGain (getProperty ("gain"));
-        }
+    // the model now matches the plugin
+    object->markStateClean();
+}
 
-        if (hasProperty ("inputGain"))
-        {
-            obj->setInputGain (getProperty ("inputGain"));
-        }
+void Node::restoreNodeProperties()
+{
+    GraphNodePtr obj = getGraphNode();
+    if (obj == nullptr)
+        return;
 
-        if (hasProperty (Tags::keyStart) && hasProperty (Tags::keyEnd))
-        {
-            Range<int> range (getProperty (Tags::keyStart, 0),
-                              getProperty (Tags::keyEnd, 127));
-            obj->setKeyRange (range);
-        }
+    if (hasProperty (Tags::bypass))
+    {
+        obj->suspendProcessing (isBypassed());
+    }
 
-        if (hasProperty (Tags::midiChannels))
-        {
-            const MidiChannels channels (getMidiChannels());
-            obj->setMidiChannels (channels.get());
-        }
+    if (hasProperty (Tags::gain))
+    {
+        obj->setGain (getProperty ("gain"));
+    }
 
-        if (hasProperty (Tags::midiProgram))
-        {
-            obj->setMidiProgram ((int) getProperty (Tags::midiProgram, -1));
-        }
+    if (hasProperty ("inputGain"))
+    {
+        obj->setInputGain (getProperty ("inputGain"));
+    }
 
-        if (hasProperty (Tags::midiProgramsEnabled))
-            obj->setMidiProgramsEnabled ((bool) getProperty (Tags::midiProgramsEnabled, true));        
-        obj->setUseGlobalMidiPrograms ((bool) getProperty (Tags::globalMidiPrograms, obj->useGlobalMidiPrograms()));
-        if (hasProperty (Tags::midiProgramsState))
-            obj->setMidiProgramsState (getProperty (Tags::midiProgramsState).toString().trim());
+    if (hasProperty (Tags::keyStart) && hasProperty (Tags::keyEnd))
+    {
+        Range<int> range (getProperty (Tags::keyStart, 0),
+                          getProperty (Tags::keyEnd, 127));
+        obj->setKeyRange (range);
+    }
 
-        obj->setMuted ((bool) getProperty (Tags::mute, obj->isMuted()));
-        obj->setMuteInput ((bool) getProperty ("muteInput", obj->isMutingInputs()));
+    if (hasProperty (Tags::midiChannels))
+    {
+        const MidiChannels channels (getMidiChannels());
+        obj->setMidiChannels (channels.get());
+    }
 
-        if (hasProperty (Tags::transpose))
-            obj->setTransposeOffset (getProperty (Tags::transpose));
-        
-        obj->setOversamplingFactor (jmax (1, (int) getProperty (Tags::oversamplingFactor, 1)));
+    if (hasProperty (Tags::midiProgram))
+    {
+        obj->setMidiProgram ((int) getProperty (Tags::midiProgram, -1));
     }
 
-    // this was originally here to help reduce memory usage
-    // need another way to free this property without disturbing
-    // the normal flow of the app.
-    const bool clearStateProperty = false;
-    if (clearStateProperty)
-        objectData.removeProperty (Tags::state, 0);
+    if (hasProperty (Tags::midiProgramsEnabled))
+        obj->setMidiProgramsEnabled ((bool) getProperty (Tags::midiProgramsEnabled, true));        
+    obj->setUseGlobalMidiPrograms ((bool) getProperty (Tags::globalMidiPrograms, obj->useGlobalMidiPrograms()));
+    if (hasProperty (Tags::midiProgramsState))
+        obj->setMidiProgramsState (getProperty (Tags::midiProgramsState).toString().trim());
 
-    for (int i = 0; i < getNumNodes(); ++i)
-        getNode(i).restorePluginState();
+    obj->setMuted ((bool) getProperty (Tags::mute, obj->isMuted()));
+    obj->setMuteInput ((bool) getProperty ("muteInput", obj->isMutingInputs()));
+
+    if (hasProperty (Tags::transpose))
+        obj->setTransposeOffset (getProperty (Tags::transpose));
+    
+    obj->setOversamplingFactor (jmax (1, (int) getProperty (Tags::oversamplingFactor, 1)));
 }
 
-void Node::savePluginState()
+bool Node::getPluginState (MemoryBlock& state) const
+{
+    return decodePluginState (objectData.getProperty (Tags::state),
+                              objectData.getProperty (Tags::stateChunk), state);
+}
+
+void Node::savePluginState (bool force)
 {
     if (! isValid())
         return;
@@ -751,36 +992,49 @@ void Node::savePluginState()
     if (obj && obj->isPrepared)
     {
         MemoryBlock state;
-        
+
+        // only serialize plugins that changed since they were last saved,
+        // cleared first so changes made while saving stay dirty
+        const bool saveState = force || obj->isStateDirty() || (! hasProperty (Tags::state) &&
+            SessionFile::getChunk (objectData) == nullptr);
+        obj->markStateClean();
+
         if (auto* proc = obj->getAudioProcessor())
         {
-            proc->getStateInformation (state);
-            if (state.getSize() > 0)
-            {
-                objectData.setProperty (Tags::state, state.toBase64Encoding(), nullptr);
-            }
-            else
+            if (saveState)
             {
-                const bool clearStateProperty = false;
-                if (clearStateProperty)
-                    objectData.removeProperty (Tags::state, 0);
-            }
+                proc->getStateInformation (state);
+                if (state.getSize() > 0)
+                {
+                    objectData.setProperty (Tags::state, state, nullptr);
+                    objectData.removeProperty (Tags::stateChunk, nullptr);
+                }
+                else
+                {
+                    const bool clearStateProperty = false;
+                    if (clearStateProperty)
+                        objectData.removeProperty (Tags::state, 0);
+                }
 
-            state.reset();
-            proc->getCurrentProgramStateInformation (state);
-            if (state.getSize() > 0)
-            {
-                objectData.setProperty (Tags::programState, state.toBase64Encoding(), 0);
+                state.reset();
+                proc->getCurrentProgramStateInformation (state);
+                if (state.getSize() > 0)
+                {
+                    objectData.setProperty (Tags::programState, state.toBase64Encoding(), 0);
+                }
             }
 
             setProperty (Tags::bypass, proc->isSuspended());
             setProperty (Tags::program, proc->getCurrentProgram());
         }
-        else
+        else if (saveState)
         {
             obj->getState (state);
             if (state.getSize() > 0)
-                objectData.setProperty (Tags::state, state.toBase64Encoding(), nullptr);
+            {
+                objectData.setProperty (Tags::state, state, nullptr);
+                objectData.removeProperty (Tags::stateChunk, nullptr);
+            }
         }
 
         setProperty (Tags::midiProgram, obj->getMidiProgram());
@@ -794,7 +1048,7 @@ void Node::savePluginState()
     }
 
     for (int i = 0; i < getNumNodes(); ++i)
-        getNode(i).savePluginState();
+        getNode(i).savePluginState (force);
 }
 
 void Node::setMuted (bool shouldBeMuted)
@@ -414,6 +414,11 @@ public:
     /** Returns a child node by UUID */
     Node getNodeByUuid (const Uuid& uuid, const bool recursive = true) const;
 
+    /** Indexes this graph's nodes and arcs so lookups by id, uuid and arc
+        don't scan the model. The index is a runtime property kept in sync
+        with the children, it is removed by sanitizeProperties */
+    void attachLookupIndex();
+
     //=========================================================================
     /** Rebuild this node's ports based on it's GraphNode object */
     void resetPorts();
@@ -426,11 +431,37 @@ public:
                      const uint32 destNode, const uint32 destPort) const;
     
     //=========================================================================
-    /** Saves the node state from GraphNode to state property */
-    void savePluginState();
+    /** Saves the node state from GraphNode to state property. Unless forced,
+        plugins which report their changes are only serialized when dirty */
+    void savePluginState (bool force = false);
     
     /** Reads state property and applies to GraphNode */
     void restorePluginState();
+
+    /** A node's saved plugin state, read from the model on the message thread.
+        restore() decodes it and hands it to the plugin, so it can run on a
+        loader thread.  The node properties are then applied with
+        restoreNodeProperties() on the message thread. */
+    class PluginStateRestorer
+    {
+    public:
+        explicit PluginStateRestorer (const Node& node);
+        void restore();
+
+    private:
+        GraphNodePtr object;
+        int program = -1;
+        var state, stateChunk;
+        String programState;
+    };
+
+    /** Applies bypass, gain, MIDI, mute and oversampling properties to the
+        GraphNode.  Called by restorePluginState() */
+    void restoreNodeProperties();
+
+    /** Gets the saved plugin state, decoding it from the session file if
+        needed. Returns false if there is no state */
+    bool getPluginState (MemoryBlock& state) const;
     
     //=========================================================================
     /** Get the number of factory presets */
@@ -25,6 +25,7 @@
 #include "Globals.h"
 
 #include "session/Session.h"
+#include "session/SessionFile.h"
 
 namespace Element {
 
@@ -53,6 +54,7 @@ namespace Element {
     private:
         friend class Session;
         Session&                     session;
+        SessionFile                  file;
     };
 
     Session::Session()
@@ -182,11 +184,13 @@ namespace Element {
     
     void Session::valueTreePropertyChanged (ValueTree& tree, const Identifier& property)
     {
-        if (property == Tags::object ||
-            (tree.hasType(Tags::node) && property == Tags::state))
-        {
+        if (property == Tags::object || property == Tags::lookupIndex)
+            return;
+
+        if (property != Tags::updater)
+            ++changeCount;
+        if (tree.hasType(Tags::node) && (property == Tags::state || property == Tags::stateChunk))
             return;
-        }
         
         if (tree == objectData && property == Tags::tempo) {
         
@@ -216,6 +220,7 @@ namespace Element {
             controlAdded (control);
         }
 
+        ++changeCount;
         notifyChanged();
     }
 
@@ -240,6 +245,7 @@ namespace Element {
             controlRemoved (control);
         }
         
+        ++changeCount;
         notifyChanged();
     }
 
@@ -247,10 +253,10 @@ namespace Element {
     void Session::valueTreeParentChanged (ValueTree& tree) { }
     void Session::valueTreeRedirected (ValueTree& tree) { }
     
-    void Session::saveGraphState()
+    void Session::saveGraphState (bool force)
     {
         for (int i = 0; i < getNumGraphs(); ++i)
-            getGraph(i).savePluginState();
+            getGraph(i).savePluginState (force);
     }
 
     void Session::restoreGraphState()
@@ -307,25 +313,22 @@ namespace Element {
 
     bool Session::writeToFile (const File& file) const
     {
-        ValueTree saveData = objectData.createCopy();
-        Node::sanitizeProperties (saveData, true);
-        TemporaryFile tempFile (file);
-
-        if (auto fos = std::unique_ptr<FileOutputStream> (tempFile.getFile().createOutputStream()))
-        {
-            {
-                GZIPCompressorOutputStream gzip (*fos, 9);
-                saveData.writeToStream (gzip);
-            }
-            fos.reset();
-            return tempFile.overwriteTargetFileWithTemporary();
-        }
-
-        return false;
+        return priv->file.write (objectData, file);
     }
 
     ValueTree Session::readFromFile (const File& file)
     {
+        if (SessionFile::isSessionFile (file))
+            return SessionFile::read (file);
+
+        // sessions saved as XML
+        if (auto xml = XmlDocument::parse (file))
+        {
+            const auto data = ValueTree::fromXml (*xml);
+            return data.hasType (Tags::session) ? data : ValueTree();
+        }
+
+        // gzipped value trees written by earlier versions
         ValueTree data;
         FileInputStream fi (file);
         
@@ -77,9 +77,13 @@ namespace Element {
         
         inline bool notificationsFrozen()   const { return freezeChangeNotification; }
 
+        /** Returns the session as XML for exporting. Documents are saved with
+            writeToFile */
         std::unique_ptr<XmlElement> createXml();
         
-        void saveGraphState();
+        /** Saves plugin states to the model. Pass true to serialize every
+            plugin, otherwise only the ones that changed are */
+        void saveGraphState (bool force = false);
         void restoreGraphState();
         
         inline int getNumControllerDevices() const { return getControllerDevicesValueTree().getNumChildren(); }
@@ -115,8 +119,15 @@ namespace Element {
         void setActiveGraph (int index);
         bool containsGraph (const Node& graph) const;
 
+        /** Returns a count of changes made to the model, including plugin
+            states. Compare with an earlier value to see if anything changed */
+        inline uint32 getChangeCount() const noexcept { return changeCount; }
+
         /** Writes an encoded file */
         bool writeToFile (const File&) const;
+
+        /** Reads session data saved in the chunked, XML or older gzipped
+            formats. Returns an invalid tree if the file isn't a session */
         static ValueTree readFromFile (const File&);
         
         Value getActiveGraphIndexObject (bool syncUpdate = false) const
@@ -155,6 +166,7 @@ namespace Element {
         friend class SessionImportWizard;
         friend struct ScopedFrozenLock;
         mutable bool freezeChangeNotification = false;
+        uint32 changeCount = 0;
         void notifyChanged();
         
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Session);
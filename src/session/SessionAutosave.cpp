@@ -0,0 +1,122 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "session/SessionAutosave.h"
+
+namespace Element {
+
+/** Drops references to engine objects so the copy can be released on
+    another thread. Undecoded state chunks are kept */
+static void removeObjectProperties (ValueTree tree)
+{
+    tree.removeProperty (Tags::object, nullptr);
+    tree.removeProperty (Tags::updater, nullptr);
+    tree.removeProperty (Tags::lookupIndex, nullptr);
+    for (int i = 0; i < tree.getNumChildren(); ++i)
+        removeObjectProperties (tree.getChild (i));
+}
+
+SessionAutosave::SessionAutosave()
+    : Thread ("el.autosave") { }
+
+SessionAutosave::~SessionAutosave()
+{
+    stop();
+}
+
+void SessionAutosave::start (SessionPtr newSession, const File& newFile, int intervalSeconds)
+{
+    stop();
+    session = newSession;
+    file = newFile;
+    hasSnapshot = false;
+
+    if (session == nullptr || intervalSeconds <= 0)
+        return;
+
+    startThread (3);
+    startTimer (intervalSeconds * 1000);
+}
+
+void SessionAutosave::stop()
+{
+    stopTimer();
+    if (isThreadRunning())
+    {
+        signalThreadShouldExit();
+        notify();
+        stopThread (5000);
+    }
+
+    ScopedLock sl (lock);
+    pending = ValueTree();
+    session = nullptr;
+}
+
+void SessionAutosave::snapshot()
+{
+    if (session == nullptr)
+        return;
+
+    // dirty plugins only, this also bumps the change count if one changed
+    session->saveGraphState();
+    if (hasSnapshot && session->getChangeCount() == lastChangeCount)
+        return;
+
+    ValueTree copy = session->getValueTree().createCopy();
+    removeObjectProperties (copy);
+    lastChangeCount = session->getChangeCount();
+    hasSnapshot = true;
+
+    {
+        ScopedLock sl (lock);
+        pending = copy;
+    }
+
+    notify();
+}
+
+void SessionAutosave::timerCallback()
+{
+    snapshot();
+}
+
+void SessionAutosave::run()
+{
+    while (! threadShouldExit())
+    {
+        wait (-1);
+
+        ValueTree data;
+        {
+            ScopedLock sl (lock);
+            std::swap (data, pending);
+        }
+
+        if (! data.isValid() || threadShouldExit())
+            continue;
+
+        if (writer.write (data, file))
+            numWritten.set (numWritten.get() + 1);
+        else
+            DBG("[EL] autosave failed: " << file.getFullPathName());
+    }
+}
+
+}
@@ -0,0 +1,72 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "session/Session.h"
+#include "session/SessionFile.h"
+
+namespace Element {
+
+/** Periodically snapshots a session and writes it on a background thread.
+
+    The snapshot is taken on the message thread. Only plugins whose state
+    changed are serialized, and nothing is written if the session didn't
+    change since the last snapshot. Compression and file writing happen on
+    the autosave thread, and the file is replaced atomically.
+*/
+class SessionAutosave : private Thread,
+                        private Timer
+{
+public:
+    SessionAutosave();
+    ~SessionAutosave();
+
+    /** Starts autosaving the session to a file every few seconds */
+    void start (SessionPtr session, const File& file, int intervalSeconds);
+
+    /** Stops autosaving, waiting for a pending write to finish */
+    void stop();
+
+    /** Takes a snapshot now if the session changed. Call on the message thread */
+    void snapshot();
+
+    /** The file being written */
+    const File& getFile() const noexcept { return file; }
+
+    /** Number of snapshots written so far */
+    int getNumWritten() const noexcept { return numWritten.get(); }
+
+private:
+    SessionPtr session;
+    File file;
+    SessionFile writer;
+    CriticalSection lock;
+    ValueTree pending;
+    uint32 lastChangeCount = 0;
+    bool hasSnapshot = false;
+    Atomic<int> numWritten { 0 };
+
+    void timerCallback() override;
+    void run() override;
+
+    JUCE_DECLARE_NON_COPYABLE (SessionAutosave)
+};
+
+}
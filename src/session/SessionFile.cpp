@@ -0,0 +1,404 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "session/Node.h"
+#include "session/SessionFile.h"
+
+namespace Element {
+
+// header: magic, version, offset of the chunk table
+static const char* const fileMagic = "ELSC";
+static const int fileVersion = 1;
+static const int headerSize = 16;
+
+// table entry: offset, stored size, raw size, flags
+static const int entrySize = 20;
+static const int flagCompressed = 1;
+
+// zlib level used per chunk, favours speed over size
+static const int compressionLevel = 1;
+
+// index of a node's state chunk in the written structure
+static const Identifier stateChunkIndex ("stateChunkIndex");
+
+static uint64 hashBytes (const void* data, size_t size) noexcept
+{
+    // FNV-1a, only used to spot unchanged states between writes
+    auto* bytes = static_cast<const uint8*> (data);
+    uint64 hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool compressChunk (const void* data, size_t size, MemoryBlock& stored)
+{
+    stored.reset();
+    {
+        MemoryOutputStream out (stored, false);
+        GZIPCompressorOutputStream gzip (out, compressionLevel);
+        gzip.write (data, size);
+    }
+
+    if (stored.getSize() + size / 8 < size)
+        return true;
+
+    stored.replaceWith (data, size);
+    return false;
+}
+
+static bool decodeChunk (const uint8* data, int storedSize, int rawSize,
+                         bool compressed, MemoryBlock& block)
+{
+    block.setSize ((size_t) rawSize, false);
+    if (! compressed)
+    {
+        if (storedSize != rawSize)
+            return false;
+        block.copyFrom (data, 0, (size_t) rawSize);
+        return true;
+    }
+
+    MemoryInputStream in (data, (size_t) storedSize, false);
+    GZIPDecompressorInputStream gzip (in);
+    return gzip.read (block.getData(), rawSize) == rawSize;
+}
+
+//==============================================================================
+class SessionFile::Source : public ReferenceCountedObject
+{
+public:
+    Source (const File& file)
+    {
+       #if JUCE_WINDOWS
+        // a mapped file couldn't be replaced when the session is saved
+        file.loadFileAsData (block);
+       #else
+        mapped.reset (new MemoryMappedFile (file, MemoryMappedFile::readOnly));
+        if (mapped->getData() == nullptr)
+        {
+            mapped = nullptr;
+            file.loadFileAsData (block);
+        }
+       #endif
+    }
+
+    const uint8* getData() const noexcept
+    {
+        return static_cast<const uint8*> (mapped != nullptr ? mapped->getData() : block.getData());
+    }
+
+    int64 getSize() const noexcept
+    {
+        return mapped != nullptr ? (int64) mapped->getSize() : (int64) block.getSize();
+    }
+
+    bool contains (int64 offset, int64 size) const noexcept
+    {
+        return offset >= 0 && size >= 0 && offset + size <= getSize();
+    }
+
+private:
+    std::unique_ptr<MemoryMappedFile> mapped;
+    MemoryBlock block;
+};
+
+//==============================================================================
+SessionFile::Chunk::Chunk (Source* s, int64 o, int stored, int raw, bool c)
+    : source (s), offset (o), storedSize (stored), rawSize (raw), compressed (c) { }
+
+SessionFile::Chunk::~Chunk() { }
+
+bool SessionFile::Chunk::decode (MemoryBlock& block) const
+{
+    if (source == nullptr || ! source->contains (offset, storedSize))
+        return false;
+    return decodeChunk (source->getData() + offset, storedSize, rawSize, compressed, block);
+}
+
+//==============================================================================
+struct SessionFile::Writer
+{
+    struct Pending
+    {
+        const void* data = nullptr;
+        int storedSize = 0, rawSize = 0;
+        bool compressed = false;
+        MemoryBlock owned;
+    };
+
+    Writer (SessionFile& f) : owner (f) { }
+
+    void addStates (ValueTree tree)
+    {
+        if (tree.hasType (Tags::node))
+        {
+            if (tree.hasProperty (Tags::state))
+                addState (tree);
+            else if (auto* chunk = SessionFile::getChunk (tree))
+                addStoredChunk (tree, *chunk);
+            tree.removeProperty (Tags::stateChunk, nullptr);
+        }
+
+        for (int i = 0; i < tree.getNumChildren(); ++i)
+            addStates (tree.getChild (i));
+    }
+
+    void addState (ValueTree& tree)
+    {
+        const var value (tree.getProperty (Tags::state));
+        MemoryBlock decoded;
+        const MemoryBlock* raw = value.getBinaryData();
+        if (raw == nullptr)
+        {
+            decoded.fromBase64Encoding (value.toString().trim());
+            raw = &decoded;
+        }
+
+        tree.removeProperty (Tags::state, nullptr);
+        if (raw->getSize() == 0)
+            return;
+
+        const String key = tree.getProperty (Tags::uuid).toString();
+        const uint64 hash = hashBytes (raw->getData(), raw->getSize());
+        const int rawSize = (int) raw->getSize();
+
+        Pending* chunk = add (tree);
+        chunk->rawSize = rawSize;
+
+        if (key.isNotEmpty())
+        {
+            used.add (key);
+            auto& entry = owner.cache[key];
+            if (entry.hash != hash || entry.rawSize != rawSize || entry.stored.getSize() == 0)
+            {
+                entry.hash = hash;
+                entry.rawSize = rawSize;
+                entry.compressed = compressChunk (raw->getData(), raw->getSize(), entry.stored);
+            }
+
+            chunk->data = entry.stored.getData();
+            chunk->storedSize = (int) entry.stored.getSize();
+            chunk->compressed = entry.compressed;
+            return;
+        }
+
+        chunk->compressed = compressChunk (raw->getData(), raw->getSize(), chunk->owned);
+        chunk->data = chunk->owned.getData();
+        chunk->storedSize = (int) chunk->owned.getSize();
+    }
+
+    void addStoredChunk (ValueTree& tree, const Chunk& stored)
+    {
+        if (stored.source == nullptr || ! stored.source->contains (stored.offset, stored.storedSize))
+            return;
+
+        // never decoded, copy it as it was read
+        Pending* chunk = add (tree);
+        chunk->data = stored.source->getData() + stored.offset;
+        chunk->storedSize = stored.storedSize;
+        chunk->rawSize = stored.rawSize;
+        chunk->compressed = stored.compressed;
+    }
+
+    Pending* add (ValueTree& tree)
+    {
+        // chunk 0 is the structure
+        tree.setProperty (stateChunkIndex, chunks.size() + 1, nullptr);
+        return chunks.add (new Pending());
+    }
+
+    bool write (const ValueTree& structure, const File& file)
+    {
+        Pending root;
+        {
+            MemoryBlock data;
+            {
+                MemoryOutputStream out (data, false);
+                structure.writeToStream (out);
+            }
+            root.rawSize = (int) data.getSize();
+            root.compressed = compressChunk (data.getData(), data.getSize(), root.owned);
+            root.data = root.owned.getData();
+            root.storedSize = (int) root.owned.getSize();
+        }
+
+        TemporaryFile tempFile (file);
+        {
+            auto out = std::unique_ptr<FileOutputStream> (tempFile.getFile().createOutputStream());
+            if (out == nullptr || out->failedToOpen())
+                return false;
+
+            out->write (fileMagic, 4);
+            out->writeInt (fileVersion);
+            out->writeInt64 (0);
+
+            Array<int64> offsets;
+            auto writeChunk = [&] (const Pending& chunk) {
+                offsets.add (out->getPosition());
+                out->write (chunk.data, (size_t) chunk.storedSize);
+            };
+
+            writeChunk (root);
+            for (const auto* chunk : chunks)
+                writeChunk (*chunk);
+
+            const int64 tableOffset = out->getPosition();
+            out->writeInt (offsets.size());
+            for (int i = 0; i < offsets.size(); ++i)
+            {
+                const Pending& chunk = i == 0 ? root : *chunks.getUnchecked (i - 1);
+                out->writeInt64 (offsets.getUnchecked (i));
+                out->writeInt (chunk.storedSize);
+                out->writeInt (chunk.rawSize);
+                out->writeInt (chunk.compressed ? flagCompressed : 0);
+            }
+
+            if (! out->setPosition (8))
+                return false;
+            out->writeInt64 (tableOffset);
+            out->flush();
+            if (out->getStatus().failed())
+                return false;
+        }
+
+        return tempFile.overwriteTargetFileWithTemporary();
+    }
+
+    void pruneCache()
+    {
+        for (auto iter = owner.cache.begin(); iter != owner.cache.end();)
+        {
+            if (used.contains (iter->first))
+                ++iter;
+            else
+                iter = owner.cache.erase (iter);
+        }
+    }
+
+    SessionFile& owner;
+    OwnedArray<Pending> chunks;
+    StringArray used;
+};
+
+//==============================================================================
+SessionFile::SessionFile() { }
+SessionFile::~SessionFile() { }
+
+bool SessionFile::isSessionFile (const File& file)
+{
+    FileInputStream in (file);
+    char magic[4] = { 0 };
+    return in.openedOk() && in.read (magic, 4) == 4 && memcmp (magic, fileMagic, 4) == 0;
+}
+
+SessionFile::Chunk* SessionFile::getChunk (const ValueTree& node)
+{
+    return dynamic_cast<Chunk*> (node.getProperty (Tags::stateChunk).getObject());
+}
+
+static void attachChunks (ValueTree tree, const Array<SessionFile::Chunk*>& chunks)
+{
+    if (tree.hasProperty (stateChunkIndex))
+    {
+        const int index = (int) tree.getProperty (stateChunkIndex);
+        if (auto* chunk = index > 0 ? chunks [index] : nullptr)
+            tree.setProperty (Tags::stateChunk, chunk, nullptr);
+        tree.removeProperty (stateChunkIndex, nullptr);
+    }
+
+    for (int i = 0; i < tree.getNumChildren(); ++i)
+        attachChunks (tree.getChild (i), chunks);
+}
+
+ValueTree SessionFile::read (const File& file)
+{
+    if (! isSessionFile (file))
+        return ValueTree();
+
+    ReferenceCountedObjectPtr<Source> source = new Source (file);
+    if (! source->contains (0, headerSize))
+        return ValueTree();
+
+    MemoryInputStream header (source->getData(), headerSize, false);
+    header.skipNextBytes (4);
+    if (header.readInt() > fileVersion)
+        return ValueTree();
+
+    const int64 tableOffset = header.readInt64();
+    if (! source->contains (tableOffset, 4))
+        return ValueTree();
+
+    MemoryInputStream table (source->getData() + tableOffset,
+                             (size_t) (source->getSize() - tableOffset), false);
+    const int numChunks = table.readInt();
+    if (numChunks <= 0 || ! source->contains (tableOffset + 4, (int64) numChunks * entrySize))
+        return ValueTree();
+
+    ReferenceCountedArray<Chunk> chunks;
+    for (int i = 0; i < numChunks; ++i)
+    {
+        const int64 offset = table.readInt64();
+        const int storedSize = table.readInt();
+        const int rawSize = table.readInt();
+        const int flags = table.readInt();
+        if (! source->contains (offset, storedSize) || rawSize < 0)
+            return ValueTree();
+        chunks.add (new Chunk (source, offset, storedSize, rawSize, (flags & flagCompressed) != 0));
+    }
+
+    MemoryBlock structure;
+    if (! chunks.getFirst()->decode (structure))
+        return ValueTree();
+
+    ValueTree data = ValueTree::readFromData (structure.getData(), structure.getSize());
+    if (data.isValid())
+    {
+        Array<Chunk*> stateChunks;
+        for (auto* chunk : chunks)
+            stateChunks.add (chunk);
+        attachChunks (data, stateChunks);
+    }
+
+    return data;
+}
+
+bool SessionFile::write (const ValueTree& data, const File& file)
+{
+    Writer writer (*this);
+    ValueTree structure = data.createCopy();
+    writer.addStates (structure);
+    Node::sanitizeProperties (structure, true);
+
+    if (! writer.write (structure, file))
+        return false;
+
+    writer.pruneCache();
+    return true;
+}
+
+void SessionFile::clearCache()
+{
+    cache.clear();
+}
+
+}
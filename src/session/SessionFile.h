@@ -0,0 +1,101 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include <map>
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Reads and writes the chunked binary session format.
+
+    The file starts with a small header pointing at a chunk table. The first
+    chunk holds the session structure, the rest hold raw plugin states. Each
+    chunk is compressed on its own with a fast zlib level, or stored as is
+    if it doesn't shrink.
+
+    When reading, plugin states aren't decoded. Nodes get a Chunk object in
+    their stateChunk property which decodes the state when it is restored.
+    When writing, states that are still undecoded are copied as stored, and
+    states which didn't change since the last write reuse their compressed
+    data, so saving only compresses what changed.
+*/
+class SessionFile
+{
+public:
+    /** The bytes of a session file, memory mapped where possible */
+    class Source;
+
+    /** A plugin state stored in a session file */
+    class Chunk : public ReferenceCountedObject
+    {
+    public:
+        Chunk (Source* source, int64 offset, int storedSize, int rawSize, bool compressed);
+        ~Chunk();
+
+        /** Decodes the state into the block, returns false on error */
+        bool decode (MemoryBlock& block) const;
+
+        /** Size of the state when decoded */
+        int getRawSize() const noexcept { return rawSize; }
+
+    private:
+        friend class SessionFile;
+        ReferenceCountedObjectPtr<Source> source;
+        int64 offset;
+        int storedSize, rawSize;
+        bool compressed;
+        JUCE_DECLARE_NON_COPYABLE (Chunk)
+    };
+
+    SessionFile();
+    ~SessionFile();
+
+    /** Returns true if the file starts with the chunked format header */
+    static bool isSessionFile (const File& file);
+
+    /** Reads a session.  Returns an invalid tree if it isn't a chunked file */
+    static ValueTree read (const File& file);
+
+    /** Returns the stored chunk of a node which hasn't been decoded */
+    static Chunk* getChunk (const ValueTree& node);
+
+    /** Writes session data to a file. Runtime properties are removed from
+        the written copy, the data passed in isn't modified */
+    bool write (const ValueTree& data, const File& file);
+
+    /** Drops compressed states kept from previous writes */
+    void clearCache();
+
+private:
+    struct Writer;
+    struct CacheEntry
+    {
+        uint64 hash = 0;
+        int rawSize = 0;
+        bool compressed = false;
+        MemoryBlock stored;
+    };
+
+    std::map<String, CacheEntry> cache;
+    JUCE_DECLARE_NON_COPYABLE (SessionFile)
+};
+
+}
@@ -0,0 +1,127 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "controllers/GraphManager.h"
+
+namespace Element {
+
+class GraphManagerRestoreTest : public UnitTestBase
+{
+public:
+    GraphManagerRestoreTest()
+        : UnitTestBase ("Graph Manager Restore", "GraphManager", "restore") { }
+
+    void initialise() override
+    {
+        initializeWorld();
+        graph.reset (new GraphProcessor());
+        graph->prepareToPlay (44100.f, 1024);
+    }
+
+    void shutdown() override
+    {
+        graph->releaseResources();
+        graph.reset (nullptr);
+        shutdownWorld();
+    }
+
+    void runTest() override
+    {
+        PluginDescription desc;
+        if (! findLV2Plugin (desc))
+        {
+            logMessage ("no LV2 plugins installed, skipping");
+            return;
+        }
+
+        beginTest ("restores several LV2 nodes");
+        auto& plugins (getWorld().getPluginManager());
+        std::unique_ptr<GraphManager> controller;
+        controller.reset (new GraphManager (*graph, plugins));
+        controller->setNodeModel (Node::createDefaultGraph());
+        const int numNodes = controller->getNumFilters();
+
+        for (int i = 0; i < numLV2Nodes; ++i)
+            controller->addFilter (&desc);
+        expectEquals (controller->getNumFilters(), numNodes + numLV2Nodes);
+        controller->savePluginStates();
+
+        ValueTree data (controller->getGraphModel().getValueTree().createCopy());
+        Node::sanitizeRuntimeProperties (data, true);
+        controller.reset (nullptr);
+        graph->clear();
+        runDispatchLoop (10);
+
+        controller.reset (new GraphManager (*graph, plugins));
+        const Node model (data, false);
+        controller->setNodeModel (model);
+        expectEquals (controller->getNumFilters(), numNodes + numLV2Nodes);
+
+        int numRestored = 0;
+        for (int i = 0; i < model.getNumNodes(); ++i)
+        {
+            const auto node (model.getNode (i));
+            if (node.getFormat().toString() != "LV2")
+                continue;
+            expect (! node.getValueTree().hasProperty (Tags::missing), "LV2 node is missing");
+            if (GraphNodePtr obj = node.getGraphNode())
+                if (obj->getAudioPluginInstance() != nullptr)
+                    ++numRestored;
+        }
+        expectEquals (numRestored, numLV2Nodes);
+
+        controller.reset (nullptr);
+        graph->clear();
+        runDispatchLoop (10);
+    }
+
+private:
+    enum { numLV2Nodes = 4 };
+    std::unique_ptr<GraphProcessor> graph;
+
+    bool findLV2Plugin (PluginDescription& result)
+    {
+        auto& plugins (getWorld().getPluginManager());
+        auto* format = plugins.getAudioPluginFormat ("LV2");
+        if (format == nullptr)
+            return false;
+
+        for (const auto& uri : format->searchPathsForPlugins (format->getDefaultLocationsToSearch(), true, false))
+        {
+            OwnedArray<PluginDescription> types;
+            format->findAllTypesForFile (types, uri);
+            for (auto* type : types)
+            {
+                String msg;
+                std::unique_ptr<AudioPluginInstance> instance (plugins.createAudioPlugin (*type, msg));
+                if (instance != nullptr)
+                {
+                    result = *type;
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+};
+
+static GraphManagerRestoreTest sGraphManagerRestoreTest;
+
+}
@@ -32,9 +32,20 @@ public:
     void runTest() override
     {
         testDefaultGraph();
+        testLookupIndex();
     }
 
 private:
+    static ValueTree makeArc (int sourceNode, int sourcePort, int destNode, int destPort)
+    {
+        ValueTree arc (Tags::arc);
+        arc.setProperty (Tags::sourceNode, sourceNode, nullptr)
+           .setProperty (Tags::sourcePort, sourcePort, nullptr)
+           .setProperty (Tags::destNode, destNode, nullptr)
+           .setProperty (Tags::destPort, destPort, nullptr);
+        return arc;
+    }
+
     void testDefaultGraph()
     {
         beginTest ("Default Graph");
@@ -48,6 +59,51 @@ private:
         node = Node::createDefaultGraph();
         expect (node.getName().isEmpty());
     }
+
+    void testLookupIndex()
+    {
+        beginTest ("Lookup Index");
+        auto graph = Node::createDefaultGraph();
+        graph.attachLookupIndex();
+        for (int i = 0; i < graph.getNumNodes(); ++i)
+        {
+            const auto node = graph.getNode (i);
+            expect (graph.getNodeById (node.getNodeId()) == node);
+            expect (graph.getNodeByUuid (node.getUuid(), false) == node);
+        }
+
+        ValueTree added (Tags::node);
+        added.setProperty (Tags::id, static_cast<int64> (100), nullptr)
+             .setProperty (Tags::uuid, Uuid().toString(), nullptr);
+        graph.getNodesValueTree().addChild (added, -1, nullptr);
+        expect (graph.getNodeById (100).getValueTree() == added);
+        added.setProperty (Tags::id, static_cast<int64> (101), nullptr);
+        expect (! graph.getNodeById (100).isValid());
+        expect (graph.getNodeById (101).getValueTree() == added);
+        graph.getNodesValueTree().removeChild (added, nullptr);
+        expect (! graph.getNodeById (101).isValid());
+
+        beginTest ("Lookup Index Arcs");
+        ValueTree arc (makeArc (1, 0, 2, 0));
+        graph.getArcsValueTree().addChild (arc, -1, nullptr);
+        expect (Node::connectionExists (graph.getArcsValueTree(), 1, 0, 2, 0));
+        expect (! Node::connectionExists (graph.getArcsValueTree(), 1, 1, 2, 0));
+        arc.setProperty (Tags::missing, true, nullptr);
+        expect (! Node::connectionExists (graph.getArcsValueTree(), 1, 0, 2, 0, true));
+
+        // arcs get replaced wholesale when the engine syncs them
+        ValueTree newArcs (Tags::arcs);
+        newArcs.addChild (makeArc (3, 1, 4, 1), -1, nullptr);
+        const auto index = graph.getValueTree().indexOf (graph.getArcsValueTree());
+        graph.getValueTree().removeChild (graph.getArcsValueTree(), nullptr);
+        graph.getValueTree().addChild (newArcs, index, nullptr);
+        expect (Node::connectionExists (graph.getArcsValueTree(), 3, 1, 4, 1));
+        expect (! Node::connectionExists (graph.getArcsValueTree(), 1, 0, 2, 0));
+
+        ValueTree copy = graph.getValueTree().createCopy();
+        Node::sanitizeProperties (copy, true);
+        expect (! copy.hasProperty (Tags::lookupIndex));
+    }
 };
 
 static NodeTests sNodeTests;
@@ -0,0 +1,223 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "session/SessionAutosave.h"
+#include "session/SessionFile.h"
+
+namespace Element {
+
+class PluginStateTest : public UnitTestBase
+{
+public:
+    PluginStateTest() : UnitTestBase ("Plugin State", "session", "pluginState") { }
+    virtual ~PluginStateTest() { }
+
+    void initialise() override
+    {
+        graph.reset (new GraphProcessor());
+        graph->prepareToPlay (44100.0, 512);
+    }
+
+    void shutdown() override
+    {
+        graph->clear();
+        graph->releaseResources();
+        graph.reset (nullptr);
+    }
+
+    void runTest() override
+    {
+        testDirtyFlag();
+        testExplicitSaves();
+    }
+
+private:
+    std::unique_ptr<GraphProcessor> graph;
+
+    /** Reports its edits to the host like a third party plugin would */
+    class TrackedPlugin : public AudioPluginInstance
+    {
+    public:
+        TrackedPlugin()
+            : AudioPluginInstance (BusesProperties()
+                .withInput  ("Main", AudioChannelSet::stereo(), true)
+                .withOutput ("Main", AudioChannelSet::stereo(), true))
+        {
+            addParameter (gain = new AudioParameterFloat ("gain", "Gain", 0.f, 1.f, 0.5f));
+        }
+
+        const String getName() const override { return "Tracked"; }
+        void fillInPluginDescription (PluginDescription& desc) const override
+        {
+            desc.name = getName();
+            desc.pluginFormatName = "Test";
+            desc.fileOrIdentifier = "element.test.tracked";
+            desc.numInputChannels = desc.numOutputChannels = 2;
+        }
+
+        void prepareToPlay (double, int) override { }
+        void releaseResources() override { }
+        void processBlock (AudioBuffer<float>&, MidiBuffer&) override { }
+        double getTailLengthSeconds() const override { return 0.0; }
+        bool acceptsMidi() const override { return false; }
+        bool producesMidi() const override { return false; }
+        bool hasEditor() const override { return false; }
+        AudioProcessorEditor* createEditor() override { return nullptr; }
+
+        int getNumPrograms() override { return 2; }
+        int getCurrentProgram() override { return program; }
+        void setCurrentProgram (int index) override { program = index; }
+        const String getProgramName (int index) override { return "Program " + String (index + 1); }
+        void changeProgramName (int, const String&) override { }
+
+        void getStateInformation (MemoryBlock& block) override
+        {
+            ++numStateReads;
+            MemoryOutputStream stream (block, false);
+            stream.writeFloat (*gain);
+            stream.writeInt (editorValue);
+        }
+
+        void setStateInformation (const void* data, int size) override
+        {
+            MemoryInputStream stream (data, (size_t) size, false);
+            *gain = stream.readFloat();
+            editorValue = stream.readInt();
+        }
+
+        AudioParameterFloat* gain = nullptr;
+        int editorValue = 0;    // changed without telling the host
+        int program = 0;
+        int numStateReads = 0;
+    };
+
+    Node createModel (GraphNode* object)
+    {
+        Node node (Tags::plugin);
+        node.getValueTree().setProperty (Tags::object, object, nullptr);
+        return node;
+    }
+
+    void testDirtyFlag()
+    {
+        auto* plugin = new TrackedPlugin();
+        GraphNodePtr object = graph->addNode (plugin);
+        Node node (createModel (object.get()));
+
+        beginTest ("new plugins are dirty");
+        expect (object->isStateDirty());
+
+        beginTest ("saving clears the dirty flag");
+        node.savePluginState();
+        expect (! object->isStateDirty());
+        expect (node.getValueTree().hasProperty (Tags::state));
+
+        beginTest ("parameter changes mark the state dirty");
+        plugin->gain->setValueNotifyingHost (0.25f);
+        expect (object->isStateDirty());
+
+        beginTest ("restoring clears the dirty flag");
+        node.restorePluginState();
+        expect (! object->isStateDirty());
+        expectEquals (plugin->gain->get(), 0.5f);
+
+        beginTest ("program changes mark the state dirty");
+        object->setCurrentProgram (1);
+        expect (object->isStateDirty());
+        node.savePluginState();
+        expect (! object->isStateDirty());
+        expectEquals ((int) node.getProperty (Tags::program), 1);
+
+        graph->removeNode (object->nodeId);
+    }
+
+    void testExplicitSaves()
+    {
+        auto* plugin = new TrackedPlugin();
+        GraphNodePtr object = graph->addNode (plugin);
+        Node node (createModel (object.get()));
+        node.savePluginState();
+
+        beginTest ("clean plugins are not serialized again");
+        const int numReads = plugin->numStateReads;
+        node.savePluginState();
+        expectEquals (plugin->numStateReads, numReads);
+
+        beginTest ("forced saves serialize unreported edits");
+        plugin->editorValue = 7;
+        expect (! object->isStateDirty());
+        node.savePluginState (true);
+        expectEquals (plugin->numStateReads, numReads + 1);
+        plugin->editorValue = 0;
+        node.restorePluginState();
+        expectEquals (plugin->editorValue, 7);
+
+        graph->removeNode (object->nodeId);
+    }
+};
+
+static PluginStateTest sPluginStateTest;
+
+class SessionAutosaveTest : public UnitTestBase
+{
+public:
+    SessionAutosaveTest() : UnitTestBase ("Session Autosave", "session", "autosave") { }
+    virtual ~SessionAutosaveTest() { }
+
+    void initialise() override
+    {
+        initializeWorld();
+    }
+
+    void shutdown() override
+    {
+        shutdownWorld();
+    }
+
+    void runTest() override
+    {
+        beginTest ("writes a loadable snapshot");
+        auto session = getWorld().getSession();
+        if (session->getNumGraphs() <= 0)
+            session->addGraph (Node::createDefaultGraph ("Graph"), true);
+        session->setName ("Autosaved");
+
+        TemporaryFile file (".els");
+        SessionAutosave autosave;
+        autosave.start (session, file.getFile(), 3600);
+        autosave.snapshot();
+        for (int i = 0; i < 100 && autosave.getNumWritten() <= 0; ++i)
+            Thread::sleep (50);
+        autosave.stop();
+        expectEquals (autosave.getNumWritten(), 1);
+        expect (SessionFile::isSessionFile (file.getFile()));
+
+        const auto data = Session::readFromFile (file.getFile());
+        expect (data.hasType (Tags::session));
+        const int numGraphs = session->getNumGraphs();
+        session->setName ("Changed");
+        expect (session->loadData (data));
+        expect (session->getName() == "Autosaved");
+        expectEquals (session->getNumGraphs(), numGraphs);
+    }
+};
+
+static SessionAutosaveTest sSessionAutosaveTest;
+
+}
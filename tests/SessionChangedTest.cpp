@@ -17,6 +17,8 @@
 */
 
 #include "Tests.h"
+#include "documents/SessionDocument.h"
+#include "session/SessionFile.h"
 
 namespace Element {
 
@@ -48,6 +50,50 @@ public:
         controller->saveSession (false);
         runDispatchLoop (40);
         expect (! controller->hasSessionChanged());
+
+        beginTest ("round trips through the session document");
+        SessionDocument document (session);
+        TemporaryFile file (".els");
+        session->setName ("Round Trip");
+        expect (document.saveDocument (file.getFile()).wasOk());
+        expect (SessionFile::isSessionFile (file.getFile()));
+
+        // copied after saving, which stores the plugin states in the model
+        const auto graph = session->getGraph (0).getValueTree().createCopy();
+        const int numGraphs = session->getNumGraphs();
+
+        session->setName ("Changed");
+        expect (document.loadDocument (file.getFile()).wasOk());
+        runDispatchLoop (40);
+        expect (session->getName() == "Round Trip");
+        expectEquals (session->getNumGraphs(), numGraphs);
+
+        const auto loadedGraph = session->getGraph (0).getValueTree();
+        const auto nodes = graph.getChildWithName (Tags::nodes);
+        const auto loadedNodes = loadedGraph.getChildWithName (Tags::nodes);
+        expectEquals (loadedNodes.getNumChildren(), nodes.getNumChildren());
+        for (int i = 0; i < nodes.getNumChildren(); ++i)
+        {
+            expect (loadedNodes.getChild(i).getProperty (Tags::uuid) == nodes.getChild(i).getProperty (Tags::uuid));
+            MemoryBlock state, loadedState;
+            Node (nodes.getChild (i), false).getPluginState (state);
+            Node (loadedNodes.getChild (i), false).getPluginState (loadedState);
+            expect (loadedState == state, "plugin state changed");
+        }
+        expectEquals (loadedGraph.getChildWithName (Tags::arcs).getNumChildren(),
+                      graph.getChildWithName (Tags::arcs).getNumChildren());
+
+        beginTest ("new sessions load a chunked template");
+        auto& settings = getWorld().getSettings();
+        settings.setDefaultNewSessionFile (file.getFile());
+        session->setName ("Changed");
+        controller->resetChanges();
+        controller->newSession();
+        runDispatchLoop (40);
+        expect (session->getName() == "Round Trip");
+        expectEquals (session->getNumGraphs(), numGraphs);
+        expectEquals (session->getGraph (0).getNumNodes(), nodes.getNumChildren());
+        settings.setDefaultNewSessionFile (File());
     }
 
 private:
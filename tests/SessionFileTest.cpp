@@ -0,0 +1,91 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "session/SessionFile.h"
+
+namespace Element {
+
+class SessionFileTest : public UnitTestBase
+{
+public:
+    SessionFileTest() : UnitTestBase ("Session File", "session", "sessionFile") { }
+    virtual ~SessionFileTest() { }
+
+    void runTest() override
+    {
+        testRoundTrip();
+    }
+
+private:
+    void testRoundTrip()
+    {
+        beginTest ("states round trip without decoding");
+        TemporaryFile first (".els"), second (".els");
+
+        MemoryBlock binary;
+        for (int i = 0; i < 4096; ++i)
+            binary.append ("state", 5);
+
+        MemoryBlock legacy ("legacy", 6);
+
+        ValueTree session (Tags::session);
+        ValueTree nodes (Tags::nodes);
+        ValueTree a (Tags::node), b (Tags::node);
+        a.setProperty (Tags::uuid, Uuid().toString(), nullptr)
+         .setProperty (Tags::state, binary, nullptr);
+        b.setProperty (Tags::state, legacy.toBase64Encoding(), nullptr);
+        nodes.addChild (a, -1, nullptr);
+        nodes.addChild (b, -1, nullptr);
+        session.addChild (nodes, -1, nullptr);
+
+        SessionFile writer;
+        expect (writer.write (session, first.getFile()));
+        expect (SessionFile::isSessionFile (first.getFile()));
+        expect (first.getFile().getSize() < (int64) binary.getSize());
+
+        auto loaded = SessionFile::read (first.getFile());
+        expect (loaded.hasType (Tags::session));
+        auto loadedA = loaded.getChildWithName (Tags::nodes).getChild (0);
+        expect (! loadedA.hasProperty (Tags::state));
+        expect (SessionFile::getChunk (loadedA) != nullptr);
+
+        MemoryBlock state;
+        expect (Node (loadedA, false).getPluginState (state));
+        expect (state == binary);
+
+        beginTest ("undecoded states are copied when written");
+        expect (writer.write (loaded, second.getFile()));
+        auto reloaded = SessionFile::read (second.getFile());
+        auto reloadedB = reloaded.getChildWithName (Tags::nodes).getChild (1);
+        expect (Node (reloadedB, false).getPluginState (state));
+        expect (state == legacy);
+
+        beginTest ("sanitizing keeps undecoded states");
+        ValueTree copy = reloaded.createCopy();
+        Node::sanitizeProperties (copy, true);
+        auto copyA = copy.getChildWithName (Tags::nodes).getChild (0);
+        expect (SessionFile::getChunk (copyA) == nullptr);
+        expect (copyA.getProperty (Tags::state).getBinaryData() != nullptr);
+        expect (*copyA.getProperty (Tags::state).getBinaryData() == binary);
+    }
+};
+
+static SessionFileTest sSessionFileTest;
+
+}
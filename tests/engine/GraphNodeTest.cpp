@@ -122,10 +122,206 @@ public:
             graph.releaseResources();
             graph.clear();
         }
+
+        {
+            GraphProcessor graph;
+            graph.setPlayConfigDetails (2, 2, 44100.0, 256);
+            graph.prepareToPlay (44100.0, 256);
+
+            GraphNodePtr audioIn = graph.addNode (new Element::GraphProcessor::AudioGraphIOProcessor (
+                GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+            GraphNodePtr audioOut = graph.addNode (new Element::GraphProcessor::AudioGraphIOProcessor (
+                GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+            GraphNodePtr midiIn = graph.addNode (new Element::GraphProcessor::AudioGraphIOProcessor (
+                GraphProcessor::AudioGraphIOProcessor::midiInputNode));
+            GraphNodePtr midiOut = graph.addNode (new Element::GraphProcessor::AudioGraphIOProcessor (
+                GraphProcessor::AudioGraphIOProcessor::midiOutputNode));
+            audioIn->connectAudioTo (audioOut);
+            graph.connectChannels (PortType::Midi, midiIn->nodeId, 0, midiOut->nodeId, 0);
+            for (int i = 0; i < 3; ++i)
+                runDispatchLoop (15);
+
+            beginTest ("splits blocks larger than the render size");
+            expect (graph.getRenderBlockSize() == 256);
+
+            AudioSampleBuffer audio (2, 1000);
+            for (int c = 0; c < 2; ++c)
+                for (int s = 0; s < audio.getNumSamples(); ++s)
+                    audio.setSample (c, s, (float) s / (float) audio.getNumSamples());
+            MidiBuffer midi;
+            midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 10);
+            midi.addEvent (MidiMessage::noteOn (1, 61, 1.f), 300);
+            midi.addEvent (MidiMessage::noteOn (1, 62, 1.f), 900);
+
+            graph.processBlock (audio, midi);
+
+            bool matches = true;
+            for (int c = 0; c < 2; ++c)
+                for (int s = 0; s < audio.getNumSamples(); ++s)
+                    matches &= audio.getSample (c, s) == (float) s / (float) audio.getNumSamples();
+            expect (matches, "audio wasn't passed through");
+
+            Array<int> frames;
+            MidiBuffer::Iterator iter (midi);
+            MidiMessage msg; int frame = 0;
+            while (iter.getNextEvent (msg, frame))
+                frames.add (frame);
+            expect (frames == Array<int> ({ 10, 300, 900 }), "midi wasn't passed through");
+
+            audioIn = audioOut = midiIn = midiOut = nullptr;
+            graph.releaseResources();
+            graph.clear();
+        }
+
+        {
+            GraphProcessor graph;
+            graph.setPlayConfigDetails (0, 2, 44100.0, 256);
+            graph.prepareToPlay (44100.0, 256);
+            graph.setSubBlockSplitting (true, 32);
+
+            auto* const recorder = new LevelRecorder();
+            GraphNodePtr midiIn = graph.addNode (new Element::GraphProcessor::AudioGraphIOProcessor (
+                GraphProcessor::AudioGraphIOProcessor::midiInputNode));
+            GraphNodePtr audioOut = graph.addNode (new Element::GraphProcessor::AudioGraphIOProcessor (
+                GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+            GraphNodePtr node = graph.addNode (recorder);
+            graph.connectChannels (PortType::Midi, midiIn->nodeId, 0, node->nodeId,
+                                   node->getPortForChannel (PortType::Midi, 0, true));
+            node->connectAudioTo (audioOut);
+            for (int i = 0; i < 3; ++i)
+                runDispatchLoop (15);
+
+            beginTest ("splits blocks at midi events");
+            AudioSampleBuffer audio (2, 512);
+            audio.clear();
+            MidiBuffer midi;
+            midi.addEvent (MidiMessage::controllerEvent (1, 7, 32), 100);
+            midi.addEvent (MidiMessage::controllerEvent (1, 7, 96), 300);
+            midi.addEvent (MidiMessage::controllerEvent (1, 7, 127), 310);
+            graph.processBlock (audio, midi);
+
+            // the event at 310 is closer than the minimum sub-block size
+            expect (recorder->blockSizes == Array<int> ({ 100, 200, 212 }), "wrong sub-block sizes");
+            expect (recorder->eventFrames == Array<int> ({ 0, 0, 10 }), "events not at the split offsets");
+
+            bool matches = true;
+            for (int s = 0; s < audio.getNumSamples(); ++s)
+            {
+                const float expected = s < 100 ? 0.f : s < 300 ? 32.f / 127.f : 127.f / 127.f;
+                matches &= audio.getSample (0, s) == expected;
+            }
+            expect (matches, "parameter changes didn't land at the split offsets");
+
+            midiIn = audioOut = node = nullptr;
+            graph.releaseResources();
+            graph.clear();
+        }
+
+        {
+            GraphProcessor graph;
+            graph.setPlayConfigDetails (0, 2, 44100.0, 256);
+            graph.setMaximumBlockSize (4096);
+            graph.prepareToPlay (44100.0, 256);
+
+            auto* const recorder = new LevelRecorder();
+            GraphNodePtr midiIn = graph.addNode (new Element::GraphProcessor::AudioGraphIOProcessor (
+                GraphProcessor::AudioGraphIOProcessor::midiInputNode));
+            GraphNodePtr audioOut = graph.addNode (new Element::GraphProcessor::AudioGraphIOProcessor (
+                GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+            GraphNodePtr node = graph.addNode (recorder);
+            graph.connectChannels (PortType::Midi, midiIn->nodeId, 0, node->nodeId,
+                                   node->getPortForChannel (PortType::Midi, 0, true));
+            node->connectAudioTo (audioOut);
+            for (int i = 0; i < 3; ++i)
+                runDispatchLoop (15);
+
+            beginTest ("renders up to the maximum block size in one pass");
+            expectEquals (graph.getRenderBlockSize(), 4096);
+            expectEquals (recorder->preparedBlockSize, 4096);
+
+            for (const int numSamples : { 4096, 1000, 4096 })
+            {
+                AudioSampleBuffer audio (2, numSamples);
+                audio.clear();
+                MidiBuffer midi;
+                // more events than the reservations for a 256 sample block hold
+                for (int i = 0; i < 2000; ++i)
+                    midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), (i * numSamples) / 2000);
+                graph.processBlock (audio, midi);
+            }
+
+            expect (recorder->blockSizes == Array<int> ({ 4096, 1000, 4096 }), "blocks were split");
+            expectEquals (recorder->eventFrames.size(), 6000);
+            expectEquals (graph.getNumDroppedMidiEvents(), 0);
+
+            bool sameBuffer = true;
+            for (auto* data : recorder->bufferData)
+                sameBuffer &= data == recorder->bufferData.getFirst();
+            expect (sameBuffer, "render buffers were reallocated");
+
+            midiIn = audioOut = node = nullptr;
+            graph.releaseResources();
+            graph.clear();
+        }
     }
 
 private:
     std::unique_ptr<Globals> globals;
+
+    /** Sets a parameter from CC 7 and renders it as a constant level over the
+        whole block, the way most plugins apply parameters once per block */
+    class LevelRecorder : public AudioProcessor
+    {
+    public:
+        LevelRecorder()
+            : AudioProcessor (BusesProperties().withOutput ("Main", AudioChannelSet::stereo()))
+        {
+            addParameter (level = new AudioParameterFloat ("level", "Level", 0.f, 1.f, 0.f));
+        }
+
+        const String getName() const override { return "Level Recorder"; }
+        void prepareToPlay (double, int maximumBlockSize) override { preparedBlockSize = maximumBlockSize; }
+        void releaseResources() override { }
+
+        void processBlock (AudioSampleBuffer& audio, MidiBuffer& midi) override
+        {
+            blockSizes.add (audio.getNumSamples());
+            bufferData.add (audio.getReadPointer (0));
+
+            MidiBuffer::Iterator iter (midi);
+            MidiMessage msg; int frame = 0;
+            while (iter.getNextEvent (msg, frame))
+            {
+                eventFrames.add (frame);
+                if (msg.isControllerOfType (7))
+                    static_cast<AudioProcessorParameter*> (level)->setValue (
+                        (float) msg.getControllerValue() / 127.f);
+            }
+
+            for (int c = 0; c < audio.getNumChannels(); ++c)
+                FloatVectorOperations::fill (audio.getWritePointer (c), level->get(), audio.getNumSamples());
+        }
+
+        double getTailLengthSeconds() const override { return 0.0; }
+        bool acceptsMidi() const override { return true; }
+        bool producesMidi() const override { return false; }
+        AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram (int) override { }
+        const String getProgramName (int) override { return String(); }
+        void changeProgramName (int, const String&) override { }
+        void getStateInformation (MemoryBlock&) override { }
+        void setStateInformation (const void*, int) override { }
+
+        Array<int> blockSizes, eventFrames;
+        Array<const float*> bufferData;
+        int preparedBlockSize = 0;
+
+    private:
+        AudioParameterFloat* level = nullptr;
+    };
     AudioProcessor* createPluginProcessor()
     {
         auto& plugins (globals->getPluginManager());
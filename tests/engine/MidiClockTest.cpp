@@ -0,0 +1,141 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiClock.h"
+
+namespace Element {
+
+class MidiClockTest : public UnitTestBase
+{
+public:
+    MidiClockTest() : UnitTestBase ("MidiClock", "engine", "midiClock") { }
+    virtual ~MidiClockTest() { }
+
+    void runTest() override
+    {
+        testLock();
+        testSongPosition();
+        testMaster();
+    }
+
+private:
+    // 120 bpm at 48kHz is 1000 samples per tick
+    const double sampleRate = 48000.0;
+    const int blockSize = 500;
+
+    void runTicks (MidiClock& clock, int numBlocks, int& block, Random& random)
+    {
+        for (int i = 0; i < numBlocks; ++i, ++block)
+        {
+            const int64 start = (int64) block * blockSize;
+            for (int64 tick = (start + 999) / 1000; tick * 1000 < start + blockSize; ++tick)
+            {
+                const int jitter = random.nextInt (97) - 48;
+                const int frame = jlimit (0, blockSize - 1, (int) (tick * 1000 - start) + jitter);
+                clock.process (MidiMessage::midiClock(), frame);
+            }
+            clock.advance (blockSize);
+        }
+    }
+
+    void testLock()
+    {
+        beginTest ("locks to jittery clock");
+        MidiClock clock;
+        clock.reset (sampleRate, blockSize);
+        clock.process (MidiMessage::midiStart(), 0);
+
+        Random random (1);
+        int block = 0;
+        runTicks (clock, 2000, block, random);
+
+        expect (clock.isLocked());
+        expect (std::abs (clock.getTempo() - 120.0) < 0.1);
+        expect (clock.getJitter() < 1.5);
+
+        const double expected = (double) block * blockSize / 24000.0;
+        expect (std::abs (clock.getSongPosition() - expected) < 0.01);
+
+        beginTest ("drops out without ticks");
+        for (int i = 0; i < 100; ++i)
+            clock.advance (blockSize);
+        expect (! clock.isLocked());
+    }
+
+    void testSongPosition()
+    {
+        beginTest ("song position pointer");
+        MidiClock clock;
+        clock.reset (sampleRate, blockSize);
+        clock.process (MidiMessage::midiStop(), 0);
+        clock.process (MidiMessage::songPositionPointer (16), 0);
+        expectEquals (clock.getSongPosition(), 4.0);
+
+        Random random (2);
+        int block = 0;
+        clock.process (MidiMessage::midiContinue(), 0);
+        runTicks (clock, 200, block, random);
+        expect (clock.getSongPosition() > 4.0);
+    }
+
+    void testMaster()
+    {
+        beginTest ("master doesn't drift");
+        // 918.75 samples per tick, ten minutes is exactly 28800 ticks
+        MidiClockMaster master;
+        master.setSampleRate (44100.0);
+        master.setTempo (120.0);
+        master.reset();
+
+        const int64 length = 26460000;
+        MidiBuffer midi;
+        int numTicks = 0;
+        int64 lastTick = 0;
+        while (master.getPosition() < length)
+        {
+            const int64 start = master.getPosition();
+            const int numSamples = (int) jmin ((int64) 512, length - start);
+            midi.clear();
+            master.render (midi, numSamples);
+
+            MidiBuffer::Iterator iter (midi);
+            const uint8* data = nullptr;
+            int numBytes = 0, frame = 0;
+            while (iter.getNextEvent (data, numBytes, frame))
+            {
+                ++numTicks;
+                lastTick = start + frame;
+            }
+        }
+
+        expectEquals (numTicks, 28799);
+        expect (lastTick == 26459082);
+
+        beginTest ("master seek");
+        expectEquals (master.seek (1.0), 4);
+        expectEquals (master.seek (1.1), 5);
+        midi.clear();
+        master.render (midi, 1);
+        expectEquals (midi.getNumEvents(), 0);
+    }
+};
+
+static MidiClockTest sMidiClockTest;
+
+}
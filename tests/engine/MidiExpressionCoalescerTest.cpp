@@ -0,0 +1,153 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiExpressionCoalescer.h"
+
+namespace Element {
+
+class MidiExpressionCoalescerTest : public UnitTestBase
+{
+public:
+    MidiExpressionCoalescerTest()
+        : UnitTestBase ("MidiExpressionCoalescer", "engine", "midiExpressionCoalescer") { }
+    virtual ~MidiExpressionCoalescerTest() { }
+
+    void initialise() override
+    {
+        coalescer.prepare (1024);
+        output.ensureSize (8192);
+    }
+
+    void runTest() override
+    {
+        testPitchBend();
+        testNoteBoundaries();
+        testSwitchControllers();
+        testHighResolutionControllers();
+    }
+
+private:
+    MidiExpressionCoalescer coalescer;
+    MidiBuffer output;
+
+    void testPitchBend()
+    {
+        beginTest ("keeps the last pitch bend per channel");
+        MidiBuffer midi;
+        for (int i = 0; i < 100; ++i)
+        {
+            midi.addEvent (MidiMessage::pitchWheel (2, 8192 + i), i);
+            midi.addEvent (MidiMessage::pitchWheel (3, 8192 - i), i);
+            midi.addEvent (MidiMessage::channelPressureChange (2, i), i);
+        }
+
+        expectEquals (coalescer.process (midi, output), 297);
+        expectEquals (output.getNumEvents(), 3);
+
+        MidiBuffer::Iterator iter (output);
+        MidiMessage msg; int frame = 0;
+        while (iter.getNextEvent (msg, frame))
+        {
+            expectEquals (frame, 99);
+            if (msg.isPitchWheel())
+                expectEquals (msg.getPitchWheelValue(), msg.getChannel() == 2 ? 8291 : 8093);
+        }
+
+        beginTest ("leaves a block without redundant events alone");
+        MidiBuffer notes;
+        notes.addEvent (MidiMessage::noteOn (1, 60, 1.f), 0);
+        notes.addEvent (MidiMessage::noteOff (1, 60), 10);
+        expectEquals (coalescer.process (notes, output), 0);
+    }
+
+    void testNoteBoundaries()
+    {
+        beginTest ("expression stays ordered around notes");
+        MidiBuffer midi;
+        midi.addEvent (MidiMessage::pitchWheel (1, 1000), 0);
+        midi.addEvent (MidiMessage::pitchWheel (1, 2000), 1);
+        midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 2);
+        midi.addEvent (MidiMessage::pitchWheel (1, 3000), 3);
+        midi.addEvent (MidiMessage::pitchWheel (1, 4000), 4);
+        midi.addEvent (MidiMessage::controllerEvent (1, 64, 127), 5);
+        midi.addEvent (MidiMessage::noteOff (1, 60), 6);
+        midi.addEvent (MidiMessage::controllerEvent (1, 64, 0), 7);
+
+        expectEquals (coalescer.process (midi, output), 2);
+        expectEquals (output.getNumEvents(), 6);
+    }
+
+    void testSwitchControllers()
+    {
+        beginTest ("pedal presses are never merged");
+        MidiBuffer midi;
+        midi.addEvent (MidiMessage::pitchWheel (1, 1000), 0);
+        midi.addEvent (MidiMessage::pitchWheel (1, 2000), 1);
+        midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 2);
+        midi.addEvent (MidiMessage::pitchWheel (1, 3000), 3);
+        midi.addEvent (MidiMessage::pitchWheel (1, 4000), 4);
+        midi.addEvent (MidiMessage::controllerEvent (1, 64, 127), 5);
+        midi.addEvent (MidiMessage::controllerEvent (1, 64, 0), 6);
+        midi.addEvent (MidiMessage::controllerEvent (1, 64, 127), 7);
+
+        expectEquals (coalescer.process (midi, output), 2);
+        expectEquals (output.getNumEvents(), 6);
+
+        Array<int> pedal;
+        MidiBuffer::Iterator iter (output);
+        MidiMessage msg; int frame = 0;
+        while (iter.getNextEvent (msg, frame))
+            if (msg.isSustainPedalOn() || msg.isSustainPedalOff())
+                pedal.add (msg.getControllerValue());
+        expect (pedal == Array<int> ({ 127, 0, 127 }), "sustain edges were lost");
+
+        MidiBuffer switches;
+        for (const int cc : { 65, 66, 67, 68, 69, 84 })
+        {
+            switches.addEvent (MidiMessage::controllerEvent (1, cc, 0), cc);
+            switches.addEvent (MidiMessage::controllerEvent (1, cc, 127), cc);
+        }
+        expectEquals (coalescer.process (switches, output), 0);
+    }
+
+    void testHighResolutionControllers()
+    {
+        beginTest ("14-bit controllers are paired");
+        MidiBuffer midi;
+        midi.addEvent (MidiMessage::controllerEvent (1, 1, 10), 0);
+        midi.addEvent (MidiMessage::controllerEvent (1, 33, 20), 0);
+        midi.addEvent (MidiMessage::controllerEvent (1, 1, 11), 1);
+        midi.addEvent (MidiMessage::controllerEvent (1, 33, 21), 1);
+        midi.addEvent (MidiMessage::controllerEvent (1, 6, 1), 2);
+        midi.addEvent (MidiMessage::controllerEvent (1, 6, 2), 3);
+
+        expectEquals (coalescer.process (midi, output), 2);
+
+        MidiBuffer::Iterator iter (output);
+        MidiMessage msg; int frame = 0;
+        expect (iter.getNextEvent (msg, frame) && msg.getControllerNumber() == 1 && msg.getControllerValue() == 11);
+        expect (iter.getNextEvent (msg, frame) && msg.getControllerNumber() == 33 && msg.getControllerValue() == 21);
+        expect (iter.getNextEvent (msg, frame) && msg.getControllerNumber() == 6);
+        expect (iter.getNextEvent (msg, frame) && msg.getControllerNumber() == 6);
+    }
+};
+
+static MidiExpressionCoalescerTest sMidiExpressionCoalescerTest;
+
+}
@@ -0,0 +1,130 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiFilterTable.h"
+
+namespace Element {
+
+class MidiFilterTableTest : public UnitTestBase
+{
+public:
+    MidiFilterTableTest() : UnitTestBase ("MidiFilterTable", "engine", "midiFilterTable") { }
+    virtual ~MidiFilterTableTest() { }
+
+    void runTest() override
+    {
+        testBypass();
+        testFilter();
+        testPrograms();
+        testDropped();
+    }
+
+private:
+    void testBypass()
+    {
+        beginTest ("default settings bypass");
+        MidiFilterTable table;
+        table.update (GraphNode::MidiFilter());
+        expect (table.isBypassed());
+
+        GraphNode::MidiFilter filter;
+        filter.transpose = 12;
+        table.update (filter);
+        expect (! table.isBypassed());
+    }
+
+    void testFilter()
+    {
+        beginTest ("key range, channels and transpose");
+        GraphNode::MidiFilter filter;
+        filter.keyLow = 48;
+        filter.keyHigh = 72;
+        filter.transpose = -12;
+        filter.channels = 0x0001;
+        filter.omni = false;
+
+        MidiFilterTable table;
+        table.update (filter);
+
+        MidiBuffer midi, scratch;
+        scratch.ensureSize (1024);
+        midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 0);
+        midi.addEvent (MidiMessage::noteOn (1, 30, 1.f), 1);    // out of range
+        midi.addEvent (MidiMessage::noteOn (2, 60, 1.f), 2);    // channel off
+        midi.addEvent (MidiMessage::controllerEvent (2, 7, 100), 3);
+        midi.addEvent (MidiMessage::controllerEvent (1, 7, 100), 4);
+        midi.addEvent (MidiMessage::noteOff (1, 60), 5);
+
+        int program = 0;
+        expectEquals (table.process (midi, scratch, program), 0);
+        expectEquals (program, -1);
+        expectEquals (midi.getNumEvents(), 3);
+
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage msg; int frame = 0;
+        expect (iter.getNextEvent (msg, frame) && msg.isNoteOn() && msg.getNoteNumber() == 48 && frame == 0);
+        expect (iter.getNextEvent (msg, frame) && msg.isController() && frame == 4);
+        expect (iter.getNextEvent (msg, frame) && msg.isNoteOff() && msg.getNoteNumber() == 48 && frame == 5);
+    }
+
+    void testPrograms()
+    {
+        beginTest ("program changes");
+        GraphNode::MidiFilter filter;
+        filter.programsEnabled = true;
+        MidiFilterTable table;
+        table.update (filter);
+
+        MidiBuffer midi, scratch;
+        scratch.ensureSize (1024);
+        midi.addEvent (MidiMessage::programChange (1, 3), 0);
+        midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 1);
+        midi.addEvent (MidiMessage::programChange (1, 5), 2);
+
+        int program = -1;
+        table.process (midi, scratch, program);
+        expectEquals (program, 5);
+        expectEquals (midi.getNumEvents(), 1);
+    }
+
+    void testDropped()
+    {
+        beginTest ("counts each dropped event");
+        GraphNode::MidiFilter filter;
+        filter.channels = 0x0001;
+        filter.omni = false;
+        MidiFilterTable table;
+        table.update (filter);
+
+        // nothing is preallocated, so every kept event is dropped
+        MidiBuffer midi, scratch;
+        midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 0);
+        midi.addEvent (MidiMessage::noteOn (2, 60, 1.f), 1);
+        midi.addEvent (MidiMessage::noteOn (1, 62, 1.f), 2);
+        midi.addEvent (MidiMessage::noteOn (1, 64, 1.f), 3);
+
+        int program = -1;
+        expectEquals (table.process (midi, scratch, program), 3);
+        expectEquals (midi.getNumEvents(), 0);
+    }
+};
+
+static MidiFilterTableTest sMidiFilterTableTest;
+
+}
@@ -0,0 +1,86 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiInputQueue.h"
+
+namespace Element {
+
+class MidiInputQueueTest : public UnitTestBase
+{
+public:
+    MidiInputQueueTest() : UnitTestBase ("MidiInputQueue", "engine", "midiInputQueue") { }
+    virtual ~MidiInputQueueTest() { }
+
+    void runTest() override
+    {
+        testPlacement();
+        testOverflow();
+    }
+
+private:
+    static int addNote (MidiInputQueue& queue, int note, double timeMs)
+    {
+        const auto msg (MidiMessage::noteOn (1, note, (uint8) 100));
+        return queue.addMessage (msg.getRawData(), msg.getRawDataSize(), timeMs) ? 1 : 0;
+    }
+
+    void testPlacement()
+    {
+        beginTest ("sample accurate placement");
+        MidiInputQueue queue;
+        queue.reset (1000.0); // one sample per millisecond
+        addNote (queue, 60, 100.0);
+        addNote (queue, 61, 105.0);
+        addNote (queue, 62, 111.0);
+
+        MidiBuffer buffer;
+        queue.removeNextBlockOfMessages (buffer, 10, 110.0);
+        expect (buffer.getNumEvents() == 2);
+        expect (buffer.getFirstEventTime() == 0);
+        expect (buffer.getLastEventTime() == 5);
+        expect (queue.hasPendingMessages());
+
+        buffer.clear();
+        queue.removeNextBlockOfMessages (buffer, 10, 120.0);
+        expect (buffer.getNumEvents() == 1);
+        expect (buffer.getFirstEventTime() == 1);
+        expect (! queue.hasPendingMessages());
+    }
+
+    void testOverflow()
+    {
+        beginTest ("overflow");
+        MidiInputQueue queue (256);
+        queue.reset (1000.0);
+        int numAdded = 0;
+        for (int i = 0; i < 20; ++i)
+            numAdded += addNote (queue, 60, 100.0);
+        expect (numAdded < 20);
+        expectEquals (queue.getNumDroppedMessages(), 20 - numAdded);
+
+        MidiBuffer buffer;
+        queue.removeNextBlockOfMessages (buffer, 64, 100.0);
+        expectEquals (buffer.getNumEvents(), numAdded);
+        expect (addNote (queue, 60, 101.0) == 1);
+    }
+};
+
+static MidiInputQueueTest sMidiInputQueueTest;
+
+}
@@ -0,0 +1,68 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiOutputScheduler.h"
+
+namespace Element {
+
+class MidiOutputSchedulerTest : public UnitTestBase
+{
+public:
+    MidiOutputSchedulerTest() : UnitTestBase ("MidiOutputScheduler", "engine", "midiOutputScheduler") { }
+    virtual ~MidiOutputSchedulerTest() { }
+
+    void runTest() override
+    {
+        testTimebase();
+    }
+
+private:
+    void testTimebase()
+    {
+        beginTest ("timebase filters callback jitter");
+        MidiOutputScheduler::Timebase timebase;
+        timebase.reset (48000.0);
+
+        // a device clock running slightly slow with up to 2ms wake-up jitter
+        const int blockSize = 480;
+        const double period = 10.01;
+        Random random (1);
+        double filteredError = 0.0, rawError = 0.0;
+
+        for (int i = 0; i < 1000; ++i)
+        {
+            const double expected = 1001.0 + period * (double) i;
+            const double now = expected - 1.0 + 2.0 * random.nextDouble();
+            const double filtered = timebase.update (now, blockSize);
+            if (i >= 900)
+            {
+                filteredError += std::abs (filtered - expected);
+                rawError += std::abs (now - expected);
+            }
+        }
+
+        expect (filteredError < rawError * 0.5);
+        expect (std::abs (timebase.getMillisecondsPerSample() * blockSize - period) < 0.01);
+        expect (timebase.getStreamPosition() == (int64) blockSize * 999);
+    }
+};
+
+static MidiOutputSchedulerTest sMidiOutputSchedulerTest;
+
+}
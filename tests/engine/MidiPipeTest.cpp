@@ -0,0 +1,70 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiPipe.h"
+
+namespace Element {
+
+class MidiPipeTest : public UnitTestBase
+{
+public:
+    MidiPipeTest() : UnitTestBase ("MidiPipe", "engine", "midiPipe") { }
+    virtual ~MidiPipeTest() { }
+
+    void runTest() override
+    {
+        testCopy();
+        testOverflow();
+    }
+
+private:
+    void testCopy()
+    {
+        beginTest ("copy and add");
+        MidiBuffer source, dest;
+        dest.ensureSize (1024);
+        for (int i = 0; i < 10; ++i)
+            source.addEvent (MidiMessage::noteOn (1, 60 + i, 1.f), i * 10);
+
+        expectEquals (MidiPipe::copyEvents (dest, source, 100), 0);
+        expectEquals (dest.getNumEvents(), 10);
+        expectEquals (MidiPipe::addEvents (dest, source, 50, 50, -50), 0);
+        expectEquals (dest.getNumEvents(), 15);
+        expectEquals (dest.getFirstEventTime(), 0);
+    }
+
+    void testOverflow()
+    {
+        beginTest ("overflow is dropped, not allocated");
+        MidiBuffer source, dest;
+        dest.ensureSize (64);
+        const int allocated = dest.data.getNumAllocated();
+        for (int i = 0; i < 100; ++i)
+            source.addEvent (MidiMessage::controllerEvent (1, 7, i), i);
+
+        const int numDropped = MidiPipe::copyEvents (dest, source, 100);
+        expect (numDropped > 0);
+        expectEquals (dest.getNumEvents() + numDropped, 100);
+        expectEquals (dest.data.getNumAllocated(), allocated);
+    }
+};
+
+static MidiPipeTest sMidiPipeTest;
+
+}
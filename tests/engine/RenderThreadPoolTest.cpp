@@ -0,0 +1,232 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/RenderThreadPool.h"
+
+namespace Element {
+
+class RenderThreadPoolTest : public UnitTestBase
+{
+public:
+    RenderThreadPoolTest() : UnitTestBase ("RenderThreadPool", "engine", "renderThreadPool") { }
+    virtual ~RenderThreadPoolTest() { }
+
+    void runTest() override
+    {
+        testCriticalPath();
+        testDependencies();
+        testParallelGraph();
+    }
+
+private:
+    /** A stateful, non-linear stereo processor so any difference in the
+        order or the data stages see shows up in the output */
+    class ShaperProcessor : public AudioProcessor
+    {
+    public:
+        ShaperProcessor (float g)
+            : AudioProcessor (BusesProperties()
+                .withInput  ("Main", AudioChannelSet::stereo())
+                .withOutput ("Main", AudioChannelSet::stereo())),
+              gain (g) { }
+
+        const String getName() const override { return "Shaper"; }
+        void prepareToPlay (double, int) override { state[0] = state[1] = 0.f; }
+        void releaseResources() override { }
+
+        void processBlock (AudioSampleBuffer& audio, MidiBuffer&) override
+        {
+            for (int c = 0; c < jmin (2, audio.getNumChannels()); ++c)
+            {
+                auto* data = audio.getWritePointer (c);
+                for (int s = 0; s < audio.getNumSamples(); ++s)
+                {
+                    state[c] = state[c] * 0.5f + data[s] * gain;
+                    data[s] = std::tanh (state[c]);
+                }
+            }
+        }
+
+        double getTailLengthSeconds() const override { return 0.0; }
+        bool acceptsMidi() const override { return false; }
+        bool producesMidi() const override { return false; }
+        AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram (int) override { }
+        const String getProgramName (int) override { return String(); }
+        void changeProgramName (int, const String&) override { }
+        void getStateInformation (MemoryBlock&) override { }
+        void setStateInformation (const void*, int) override { }
+
+    private:
+        const float gain;
+        float state[2] = { 0.f, 0.f };
+    };
+
+    /** in -> a -> b -> out, in -> c -> out and in -> d -> out */
+    static void buildGraph (GraphProcessor& graph, Array<GraphNodePtr>& nodes)
+    {
+        graph.setPlayConfigDetails (2, 2, 44100.0, 256);
+        graph.prepareToPlay (44100.0, 256);
+
+        auto* const audioIn = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        auto* const audioOut = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        auto* const a = graph.addNode (new ShaperProcessor (1.5f));
+        auto* const b = graph.addNode (new ShaperProcessor (0.7f));
+        auto* const c = graph.addNode (new ShaperProcessor (2.3f));
+        auto* const d = graph.addNode (new ShaperProcessor (0.4f));
+
+        audioIn->connectAudioTo (a);
+        a->connectAudioTo (b);
+        b->connectAudioTo (audioOut);
+        audioIn->connectAudioTo (c);
+        c->connectAudioTo (audioOut);
+        audioIn->connectAudioTo (d);
+        d->connectAudioTo (audioOut);
+        for (auto* node : { audioIn, audioOut, a, b, c, d })
+            nodes.add (node);
+    }
+
+    void testParallelGraph()
+    {
+        beginTest ("parallel graph output matches serial");
+        RenderThreadPool pool (2);
+        GraphProcessor serial, parallel;
+        Array<GraphNodePtr> serialNodes, parallelNodes;
+        buildGraph (serial, serialNodes);
+        buildGraph (parallel, parallelNodes);
+        parallel.setRenderThreadPool (&pool);
+        for (int i = 0; i < 3; ++i)
+            MessageManager::getInstance()->runDispatchLoopUntil (15);
+
+        Random random (1234);
+        bool identical = true;
+        for (int block = 0; block < 50; ++block)
+        {
+            AudioSampleBuffer serialAudio (2, 256), parallelAudio (2, 256);
+            for (int c = 0; c < 2; ++c)
+                for (int s = 0; s < 256; ++s)
+                    serialAudio.setSample (c, s, random.nextFloat() * 2.f - 1.f);
+            parallelAudio.makeCopyOf (serialAudio);
+
+            MidiBuffer serialMidi, parallelMidi;
+            serial.processBlock (serialAudio, serialMidi);
+            parallel.processBlock (parallelAudio, parallelMidi);
+
+            for (int c = 0; c < 2; ++c)
+                identical &= 0 == memcmp (serialAudio.getReadPointer (c), parallelAudio.getReadPointer (c),
+                                          sizeof (float) * 256);
+        }
+
+        expect (identical, "parallel rendering changed the output");
+
+        parallel.setRenderThreadPool (nullptr);
+        serialNodes.clearQuick();
+        parallelNodes.clearQuick();
+        serial.releaseResources();
+        serial.clear();
+        parallel.releaseResources();
+        parallel.clear();
+    }
+
+    struct OrderRecorder : public RenderSchedule::Performer
+    {
+        OrderRecorder (int numStages)
+        {
+            for (int i = 0; i < numStages; ++i)
+                finished.add (new Atomic<int> (-1));
+        }
+
+        void performStage (int stage) override
+        {
+            finished.getUnchecked(stage)->set (counter.fetch_add (1));
+        }
+
+        int order (int stage) const { return finished.getUnchecked(stage)->get(); }
+
+        OwnedArray<Atomic<int>> finished;
+        std::atomic<int> counter { 0 };
+    };
+
+    void testCriticalPath()
+    {
+        beginTest ("critical path");
+        RenderSchedule chain;
+        for (int i = 0; i < 4; ++i)
+            chain.addStage();
+        for (int i = 1; i < 4; ++i)
+            chain.addDependency (i - 1, i);
+        chain.finalize();
+        expect (chain.getCriticalPathLength() == 4);
+        expect (! chain.canRenderInParallel());
+
+        RenderSchedule wide;
+        for (int i = 0; i < 4; ++i)
+            wide.addStage();
+        wide.addDependency (0, 3);
+        wide.addDependency (1, 3);
+        wide.addDependency (2, 3);
+        wide.finalize();
+        expect (wide.getCriticalPathLength() == 2);
+        expect (wide.canRenderInParallel());
+    }
+
+    void testDependencies()
+    {
+        beginTest ("dependencies are honored");
+
+        // two independent branches of four stages merging into a final stage
+        RenderSchedule schedule;
+        for (int i = 0; i < 9; ++i)
+            schedule.addStage();
+        for (int i = 1; i < 4; ++i)
+        {
+            schedule.addDependency (i - 1, i);
+            schedule.addDependency (i + 3, i + 4);
+        }
+        schedule.addDependency (3, 8);
+        schedule.addDependency (7, 8);
+        schedule.finalize();
+
+        RenderThreadPool pool (2);
+        for (int cycle = 0; cycle < 100; ++cycle)
+        {
+            OrderRecorder recorder (schedule.getNumStages());
+            pool.perform (schedule, recorder);
+            expect (! pool.isPerforming());
+            expect (recorder.counter.load() == 9);
+
+            for (int i = 1; i < 4; ++i)
+            {
+                expect (recorder.order (i - 1) < recorder.order (i));
+                expect (recorder.order (i + 3) < recorder.order (i + 4));
+            }
+
+            expect (recorder.order (8) == 8);
+        }
+    }
+};
+
+static RenderThreadPoolTest sRenderThreadPoolTest;
+
+}